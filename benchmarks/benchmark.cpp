@@ -0,0 +1,467 @@
+/**
+ * benchmark.cpp
+ *
+ * Measures the throughput of the Regex, Scanner and Parser modules (and of visiting the trees
+ * built by the latter) on generated inputs, and
+ * writes the results to stdout as JSON so runs can be compared against one another. Each
+ * benchmark is repeated until a minimum amount of time has elapsed.
+ *
+ * Usage: benchmark [--grammars DIR] [--filter SUBSTRING] [--min-time SECONDS]
+ *
+ * Grammars are read from DIR (by default "grammars", i.e. run from the root of the repository).
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Parser/ASTIndex.h"
+#include "Parser/Parser.h"
+
+using namespace sage;
+
+/**
+ * Configuration
+ * ================================
+ */
+namespace
+{
+    std::string grammars = "grammars";
+    std::string filter;
+    double min_time = 0.5;
+
+    // Fixed so that every run measures identical inputs
+    const unsigned int seed = 2015;
+
+    struct Result
+    {
+        std::string name;
+        unsigned long iterations;
+        double seconds;
+        unsigned long bytes;    // Bytes processed per iteration (0 if not applicable)
+        unsigned long items;    // Items (e.g. tokens) processed per iteration
+    };
+
+    std::vector<Result> results;
+}
+
+/**
+ * Measure
+ * ================================
+ *
+ * Runs @body repeatedly until @min_time has elapsed (at least once). The body returns
+ * a value that is accumulated so the compiler cannot discard the work done.
+ */
+template<typename F>
+void measure(std::string name, unsigned long bytes, unsigned long items, F body)
+{
+    if(name.find(filter) == std::string::npos) {
+        return;
+    }
+
+    unsigned long iterations = 0;
+    unsigned long sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        sink += body();
+        iterations++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    } while(elapsed < min_time);
+
+    // Referencing the sink keeps the work observable
+    if(sink == static_cast<unsigned long>(-1)) {
+        std::cerr << sink;
+    }
+
+    results.push_back({ name, iterations, elapsed, bytes, items });
+}
+
+/**
+ * Generators
+ * ================================
+ *
+ * Build the synthetic inputs used below. Arithmetic expressions nest parentheses at random,
+ * while palindromes are spelled out letter by letter (separated by spaces).
+ */
+std::string generateWords(unsigned long size, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> letter('a', 'z'), length(1, 12);
+    std::string result;
+    while(result.size() < size) {
+        for(int i = length(rng); i > 0; i--) {
+            result += static_cast<char>(letter(rng));
+        }
+        result += ' ';
+    }
+    return result;
+}
+
+std::string generateIntegers(unsigned long size, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> value(0, 1000000);
+    std::string result;
+    while(result.size() < size) {
+        result += std::to_string(value(rng)) + ' ';
+    }
+    return result;
+}
+
+void generateExpression(std::string& result, unsigned long size, int depth, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> value(0, 1000), op(0, 3), nest(0, 4);
+    const char operators[] = { '+', '-', '*', '/' };
+    while(true) {
+        if(depth < 8 && nest(rng) == 0) {
+            result += "(";
+            generateExpression(result, result.size() + 64, depth + 1, rng);
+            result += ")";
+        } else {
+            result += std::to_string(value(rng));
+        }
+        if(result.size() >= size) {
+            return;
+        }
+        result += ' ';
+        result += operators[op(rng)];
+        result += ' ';
+    }
+}
+
+std::string generatePalindrome(unsigned long letters, std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::string half;
+    for(unsigned long i = 0; i < letters / 2; i++) {
+        half += static_cast<char>(letter(rng));
+    }
+
+    std::string result;
+    for(auto c : half) {
+        result += c;
+        result += ' ';
+    }
+    result += static_cast<char>(letter(rng));
+    for(auto it = half.rbegin(); it != half.rend(); it++) {
+        result += ' ';
+        result += *it;
+    }
+    return result;
+}
+
+/**
+ * Regex Benchmarks
+ * ================================
+ */
+void benchmarkRegex()
+{
+    std::mt19937 rng(seed);
+
+    // Compile time of expressions of increasing complexity. The cache is cleared
+    // beforehand, since the expression would otherwise only be compiled once.
+    const std::vector<std::pair<std::string, std::string>> expressions = {
+        { "identifier", "[a-zA-Z_][a-zA-Z0-9_]*" },
+        { "number", "[+\\-]?\\d+(\\.\\d+)?([eE][+\\-]?\\d+)?" },
+        { "keywords", "(if|else|while|for|return|break|continue|switch|case|default)" },
+        { "repetition", "(a|b)*a(a|b){6}" },
+    };
+    for(auto& expr : expressions) {
+        measure("regex/compile/" + expr.first, 0, 1, [&]() {
+            RegexCache::global().clear();
+            Regex r(expr.second);
+            return static_cast<unsigned long>(r.getFrontWordBounded());
+        });
+    }
+
+    // Matching a single long token, and many short tokens, in one go
+    std::string letters(1 << 16, 'a');
+    for(auto& c : letters) {
+        c = static_cast<char>('a' + rng() % 26);
+    }
+    Regex word("[a-z]+");
+    measure("regex/matches/long-word", letters.size(), 1, [&]() {
+        return static_cast<unsigned long>(word.matches(letters));
+    });
+
+    std::vector<std::string> numbers;
+    unsigned long number_bytes = 0;
+    for(int i = 0; i < 4096; i++) {
+        std::stringstream ss;
+        ss << rng() % 100000 << '.' << rng() % 1000 << 'e' << (rng() % 2 ? "+" : "-") << rng() % 30;
+        numbers.push_back(ss.str());
+        number_bytes += numbers.back().size();
+    }
+    Regex number(expressions[1].second);
+    measure("regex/matches/numbers", number_bytes, numbers.size(), [&]() {
+        unsigned long count = 0;
+        for(auto& n : numbers) {
+            count += number.matches(n);
+        }
+        return count;
+    });
+
+    // Note finding restarts matching at every index, so this is quadratic in the input
+    std::string haystack = letters.substr(0, 1024) + "12345";
+    Regex digits("\\d+");
+    measure("regex/find/suffix", haystack.size(), 1, [&]() {
+        return static_cast<unsigned long>(digits.find(haystack));
+    });
+}
+
+/**
+ * Scanner Benchmarks
+ * ================================
+ */
+void benchmarkScanner()
+{
+    std::mt19937 rng(seed);
+
+    std::string words = generateWords(1 << 16, rng);
+    unsigned long word_count = 0;
+    for(auto c : words) {
+        word_count += (c == ' ');
+    }
+    measure("scanner/nextWord", words.size(), word_count, [&]() {
+        std::stringstream input(words);
+        Scanner s(input);
+        unsigned long count = 0;
+        while(s.hasNext()) {
+            count += s.nextWord().size();
+        }
+        return count;
+    });
+
+    std::string integers = generateIntegers(1 << 16, rng);
+    unsigned long integer_count = 0;
+    for(auto c : integers) {
+        integer_count += (c == ' ');
+    }
+    measure("scanner/nextInt", integers.size(), integer_count, [&]() {
+        std::stringstream input(integers);
+        Scanner s(input);
+        unsigned long count = 0;
+        while(s.hasNext()) {
+            count += s.nextInt();
+        }
+        return count;
+    });
+
+    Regex identifier("[a-z]+");
+    measure("scanner/next", words.size(), word_count, [&]() {
+        std::stringstream input(words);
+        Scanner s(input);
+        unsigned long count = 0;
+        while(s.hasNext()) {
+            count += s.next(identifier).size();
+        }
+        return count;
+    });
+}
+
+/**
+ * Parser Benchmarks
+ * ================================
+ *
+ * Each grammar is parsed under every option, and the parse is verified to succeed
+ * beforehand (so as not to time a failing parse).
+ */
+void benchmarkParser()
+{
+    std::mt19937 rng(seed);
+
+    std::string expression;
+    generateExpression(expression, 1 << 13, 0, rng);
+    std::string palindrome = generatePalindrome(201, rng);
+
+    const std::vector<std::pair<std::string, int>> options = {
+        { "default", Parser::OPTION_NONE },
+        { "multi-pattern", Parser::OPTION_MULTI_PATTERN },
+        { "token-stream", Parser::OPTION_TOKEN_STREAM },
+    };
+
+    const std::vector<std::pair<std::string, std::string>> inputs = {
+        { "arithmetic", expression },
+        { "palindrome", palindrome },
+    };
+
+    for(auto& input : inputs) {
+        for(auto& option : options) {
+            std::string name = "parser/" + input.first + "/" + option.first;
+            if(name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            Parser parser(grammars + "/" + input.first + ".peg", option.second);
+            std::stringstream check(input.second);
+            if(!parser.parse(check)) {
+                std::cerr << "Could not parse input of " << name << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+
+            measure(name, input.second.size(), 1, [&]() {
+                std::stringstream stream(input.second);
+                return static_cast<unsigned long>(parser.parse(stream) != nullptr);
+            });
+
+            ParseOptions flattened;
+            flattened.flatten = true;
+            measure(name + "/flatten", input.second.size(), 1, [&]() {
+                std::stringstream stream(input.second);
+                return static_cast<unsigned long>(parser.parse(stream, flattened) != nullptr);
+            });
+        }
+    }
+
+    // Many tiny documents, each parsed with a fresh scanner or by reusing a context
+    std::vector<std::string> documents;
+    unsigned long document_bytes = 0;
+    for(int i = 0; i < 1024; i++) {
+        std::string document;
+        generateExpression(document, 16, 6, rng);
+        documents.push_back(document);
+        document_bytes += document.size();
+    }
+
+    for(auto& option : options) {
+        std::string name = "parser/documents/" + option.first;
+        if(name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        Parser parser(grammars + "/arithmetic.peg", option.second);
+        measure(name + "/fresh", document_bytes, documents.size(), [&]() {
+            unsigned long count = 0;
+            for(auto& document : documents) {
+                std::stringstream stream(document);
+                count += (parser.parse(stream) != nullptr);
+            }
+            return count;
+        });
+
+        ParseContext context;
+        measure(name + "/context", document_bytes, documents.size(), [&]() {
+            unsigned long count = 0;
+            for(auto& document : documents) {
+                count += (parser.parse(context, document) != nullptr);
+            }
+            return count;
+        });
+    }
+}
+
+/**
+ * Tree
+ * ================================
+ *
+ * Visits the tree of a single (large) expression. Items are the nodes of the tree.
+ */
+void benchmarkTree()
+{
+    std::mt19937 rng(seed);
+
+    std::string expression;
+    generateExpression(expression, 1 << 16, 0, rng);
+
+    Parser parser(grammars + "/arithmetic.peg");
+    std::stringstream stream(expression);
+    auto ast = parser.parse(stream);
+    if(!ast) {
+        std::cerr << "Could not parse input of tree benchmarks" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    unsigned long nodes = 0;
+    for(auto it = ast->preorder().begin(); it != AST::Iterator(); ++it) {
+        nodes++;
+    }
+
+    if(std::string("tree/preorder").find(filter) != std::string::npos) {
+        measure("tree/preorder", 0, nodes, [&]() {
+            unsigned long count = 0;
+            for(auto& node : ast->preorder()) {
+                count += node.getChildCount();
+            }
+            return count;
+        });
+    }
+
+    if(std::string("tree/format").find(filter) != std::string::npos) {
+        measure("tree/format", 0, nodes, [&]() {
+            std::stringstream output;
+            ast->format(output);
+            return static_cast<unsigned long>(output.tellp());
+        });
+    }
+
+    if(std::string("tree/serialize").find(filter) != std::string::npos) {
+        measure("tree/serialize", 0, nodes, [&]() {
+            std::stringstream output;
+            ast->serialize(output);
+            return static_cast<unsigned long>(output.tellp());
+        });
+    }
+
+    if(std::string("tree/index").find(filter) != std::string::npos) {
+        measure("tree/index", 0, nodes, [&]() {
+            ASTIndex index(ast);
+            return index.findAll(index.getRule("Value")).size();
+        });
+    }
+}
+
+/**
+ * Report
+ * ================================
+ *
+ * Names never contain characters requiring escaping, so the JSON is written out directly.
+ */
+void report(std::ostream& out)
+{
+    out << "{\n  \"min_time\": " << min_time << ",\n  \"benchmarks\": [";
+    for(unsigned long i = 0; i < results.size(); i++) {
+        auto& r = results[i];
+        double per_iteration = r.seconds / r.iterations;
+        out << (i ? "," : "") << "\n    {"
+            << "\"name\": \"" << r.name << "\", "
+            << "\"iterations\": " << r.iterations << ", "
+            << "\"seconds\": " << r.seconds << ", "
+            << "\"ns_per_iteration\": " << per_iteration * 1e9 << ", "
+            << "\"items_per_second\": " << r.items / per_iteration;
+        if(r.bytes) {
+            out << ", \"bytes\": " << r.bytes
+                << ", \"mb_per_second\": " << r.bytes / per_iteration / (1 << 20);
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--grammars" && i + 1 < argc) {
+            grammars = argv[++i];
+        } else if(arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if(arg == "--min-time" && i + 1 < argc) {
+            min_time = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--grammars DIR] [--filter SUBSTRING] [--min-time SECONDS]"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    benchmarkRegex();
+    benchmarkScanner();
+    benchmarkParser();
+    benchmarkTree();
+    report(std::cout);
+
+    return EXIT_SUCCESS;
+}
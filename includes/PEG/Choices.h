@@ -24,10 +24,16 @@ namespace sage
     class Choices : public Definition
     {
         public:
-            Choices(Scanner&);
-            Choices(Scanner&&);
+            Choices(Scanner&, int = Regex::FLAG_NONE);
+            Choices(Scanner&&, int = Regex::FLAG_NONE);
             virtual ~Choices() = default;
             virtual std::shared_ptr<AST> process(Scanner&, const symbol_table&);
+            virtual void collectTerminals(std::shared_ptr<RegexSet>);
+            virtual void identifyRules(const std::map<std::string, unsigned int>&);
+            virtual void annotateRules(const std::map<std::string, RULE_ANNOTATION>&);
+
+        protected:
+            virtual bool processInto(Scanner&, const symbol_table&, std::vector<std::shared_ptr<AST>>&);
 
         private:
             std::vector<std::shared_ptr<Sequence>> options;
@@ -14,8 +14,13 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Parser/AST.h"
+#include "Parser/NodeTable.h"
+#include "Parser/ParseOptions.h"
+#include "Parser/Profiler.h"
+#include "Parser/Tracer.h"
 #include "Parser/Scanner.h"
 
 namespace sage
@@ -36,6 +41,37 @@ namespace sage
             // function manages the number of times processing should occur.
             std::shared_ptr<AST> parse(Scanner&, const symbol_table&);
 
+            // Parses as above, but appends the resulting nodes to the passed list instead of
+            // building a node of them, such that no branches or empty nodes are ever built (see
+            // ParseOptions::flatten). Returns false, leaving the list as it was, on failure.
+            bool parseInto(Scanner&, const symbol_table&, std::vector<std::shared_ptr<AST>>&);
+
+            // The node made of the nodes in the list from the given index onward: an empty node
+            // if there are none, the node itself if there is one, and their branches otherwise
+            static std::shared_ptr<AST> join(const std::vector<std::shared_ptr<AST>>&, unsigned long = 0);
+
+            // Adds every terminal of the definition into the passed set. Terminals then
+            // refer to the set when processing, such that all terminals of the grammar
+            // are tested at once at a given position (see @RegexSet).
+            virtual void collectTerminals(std::shared_ptr<RegexSet>);
+
+            // Informs every nonterminal of the definition of the index of the rule it refers
+            // to, as given by the passed map (see @Tracer).
+            virtual void identifyRules(const std::map<std::string, unsigned int>&);
+
+            // Shapes the node of a rule takes in flattened trees, as declared by the grammar
+            // (e.g. "%inline Value;"). Rules are not annotated by default.
+            enum RULE_ANNOTATION
+            {
+                ANNOTATE_NONE,          // The rule has a node, whose child holds the nodes of the rule
+                ANNOTATE_INLINE,        // The nodes of the rule take the place of its node
+                ANNOTATE_TRANSPARENT,   // As above, if the rule has a single node, and as usual otherwise
+                ANNOTATE_LEAF           // The child of the node is a terminal of the tokens matched
+            };
+
+            // Informs every nonterminal of the definition of the annotation of the rule it refers to
+            virtual void annotateRules(const std::map<std::string, RULE_ANNOTATION>&);
+
             // Indicates how often a definition should be repeated. This mirrors the operators
             // present in a regular expression. We make this publicly accessible since, during the
             // reading in of the *.peg file, we need to modify the operators for each definition anyways
@@ -52,6 +88,13 @@ namespace sage
             // Processing is the act of parsing once according to a given definition
             virtual std::shared_ptr<AST> process(Scanner&, const symbol_table&) = 0;
 
+            // Processing once into a list of nodes (see @parseInto). By default the node built by
+            // @process is appended.
+            virtual bool processInto(Scanner&, const symbol_table&, std::vector<std::shared_ptr<AST>>&);
+
+            // Appends a node to the list, replacing branches by their children and dropping empty nodes
+            static void append(std::vector<std::shared_ptr<AST>>&, const std::shared_ptr<AST>&);
+
         private:
 
             // Utility methods for code cleanliness
@@ -3,6 +3,10 @@
  *
  * A nonterminal simply references another definition, provided in the symbol table.
  *
+ * In flattened trees, the node of a nonterminal is shaped by the annotation of the rule it
+ * refers to (see RULE_ANNOTATION). Note a leaf still builds the nodes beneath it while parsing,
+ * and gathers their tokens once done.
+ *
  * Created by jrpotter (12/16/2015).
  */
 
@@ -19,9 +23,20 @@ namespace sage
             Nonterminal(std::string);
             virtual ~Nonterminal() = default;
             virtual std::shared_ptr<AST> process(Scanner&, const symbol_table&);
+            virtual void identifyRules(const std::map<std::string, unsigned int>&);
+            virtual void annotateRules(const std::map<std::string, RULE_ANNOTATION>&);
+
+        protected:
+            virtual bool processInto(Scanner&, const symbol_table&, std::vector<std::shared_ptr<AST>>&);
 
         private:
             std::string reference;
+            unsigned int rule;
+            RULE_ANNOTATION annotation;
+
+            // Replaces the nodes of the rule (from the given index onward) by the node of the rule,
+            // given the positions the rule began and ended at
+            void wrap(std::vector<std::shared_ptr<AST>>&, unsigned long, long, long);
     };
 }
 
@@ -22,6 +22,9 @@ namespace sage
             Sequence() = default;
             virtual ~Sequence() = default;
             virtual std::shared_ptr<AST> process(Scanner&, const symbol_table&);
+            virtual void collectTerminals(std::shared_ptr<RegexSet>);
+            virtual void identifyRules(const std::map<std::string, unsigned int>&);
+            virtual void annotateRules(const std::map<std::string, RULE_ANNOTATION>&);
 
             // We allow appending to the sequence during the parsing process
             void append(std::shared_ptr<Definition>);
@@ -29,8 +32,14 @@ namespace sage
             // Change the last values repeat operator value
             void setLastOperator(char);
 
+        protected:
+            virtual bool processInto(Scanner&, const symbol_table&, std::vector<std::shared_ptr<AST>>&);
+
         private:
             std::vector<std::shared_ptr<Definition>> order;
+
+            // Number of leading elements which may fail (see @process)
+            unsigned long commitPoint() const;
     };
 }
 
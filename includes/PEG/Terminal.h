@@ -18,15 +18,20 @@ namespace sage
     class Terminal : public Definition
     {
         public:
-            Terminal(std::string);
+            Terminal(std::string, int = Regex::FLAG_NONE);
             virtual ~Terminal() = default;
 
             // Note the terminal does not need to use a symbol table, but we
             // provide it anyways to force the abstraction process.
             virtual std::shared_ptr<AST> process(Scanner&, const symbol_table&);
+            virtual void collectTerminals(std::shared_ptr<RegexSet>);
 
         private:
             Regex expr;
+
+            // Set the terminal belongs to, if any, and its index within it
+            std::shared_ptr<RegexSet> terminals;
+            unsigned int index;
     };
 }
 
@@ -5,6 +5,18 @@
  * by the Parser class. It is a tagged union, and, as such, constructing
  * and destructing must be manually handled.
  *
+ * Every node records the span of input it covers, as offsets (see Scanner::getPosition).
+ * Nodes covering nothing (empty nodes, and branches of only empty nodes) have a span
+ * of -1 to -1. Nonterminal nodes also record the index of their rule (see Tracer),
+ * which is NO_RULE for all other nodes.
+ *
+ * Trees may be written out in a compact binary form with @serialize, and read back
+ * in place (without rebuilding the tree) with an ASTReader.
+ *
+ * Nothing here recurses once per level of the tree; traversals (see Iterator) keep an
+ * explicit stack, and destruction detaches descendants before destroying them, so that
+ * arbitrarily deep trees neither overflow the stack when visited nor when freed.
+ *
  * Created by jrpotter (12/16/2015).
  */
 
@@ -13,26 +25,114 @@
 
 #include <iomanip>
 #include <memory>
+#include <ostream>
 #include <sstream>
 #include <vector>
 
+#include "macro.h"
+
+#include "Tracer.h"
+
 namespace sage
 {
     class AST
     {
         public:
+
+            // The kind of node, determining which of the getters below apply
+            enum AST_TAG
+            {
+                EMPTY,          // A successful parse requiring no nodes
+                TERMINAL,       // A matched token
+                NONTERMINAL,    // A rule, with a single child
+                BRANCHES        // A sequence or repetition, with any number of children
+            };
+
+            // Visits every node of a tree in either preorder or postorder, without recursing.
+            // Children are visited in order, and nodes shared by several parents (see
+            // ParseOptions::share_nodes) are visited once for every parent.
+            class Iterator
+            {
+                public:
+                    enum ORDER { PREORDER, POSTORDER };
+
+                    // The end of any traversal
+                    Iterator();
+                    Iterator(const AST*, ORDER);
+
+                    const AST& operator* () const;
+                    const AST* operator-> () const;
+                    Iterator& operator++ ();
+                    bool operator== (const Iterator&) const;
+                    bool operator!= (const Iterator&) const;
+
+                    // Number of ancestors of the current node (within the traversed tree)
+                    unsigned long getDepth() const;
+
+                private:
+                    ORDER order;
+
+                    // The path from the root to the current node, along with the next
+                    // child to visit of each node on it
+                    struct Frame
+                    {
+                        const AST* node;
+                        unsigned long next;
+                    };
+                    std::vector<Frame> stack;
+
+                    // Pushes the next child of the current node, returning false if none remain
+                    bool descend();
+            };
+
+            // A traversal, for use in range based for loops
+            struct Traversal
+            {
+                Iterator first;
+                Iterator begin() const { return first; }
+                Iterator end() const { return Iterator(); }
+            };
+
             AST();
-            AST(std::string);
-            AST(std::string, std::shared_ptr<AST>);
+            AST(std::string, long = -1, long = -1);
+            AST(std::string, std::shared_ptr<AST>, unsigned int = Tracer::NO_RULE, long = -1);
             AST(std::vector<std::shared_ptr<AST>>);
             ~AST();
 
+            // Getters
+            AST_TAG getTag() const;
+            long getStart() const;
+            long getEnd() const;
+            unsigned int getRule() const;
+
+            // The name of the rule (nonterminals only) and the matched text (terminals only)
+            const std::string& getType() const;
+            const std::string& getToken() const;
+
+            // Children of nonterminals (of which there is one) and branches
+            unsigned long getChildCount() const;
+            const std::shared_ptr<AST>& getChild(unsigned long) const;
+
+            // Traversals of the tree rooted at this node
+            Traversal preorder() const;
+            Traversal postorder() const;
+
             // Useful for quick analyzing of tree
             void format(std::stringstream&, int=0) const;
 
+            // Writes the tree out in the format read by ASTReader (throwing InvalidAST if too large)
+            void serialize(std::ostream&) const;
+
         private:
+
+            // Moves the uniquely owned children of this node onto the passed list
+            void detach(std::vector<std::shared_ptr<AST>>&);
+
             std::string type;
-            enum { EMPTY, TERMINAL, NONTERMINAL, BRANCHES } tag;
+            unsigned int rule;
+            long start;
+            long end;
+            AST_TAG tag;
             union {
                 std::string token;
                 std::shared_ptr<AST> child;
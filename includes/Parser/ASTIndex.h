@@ -0,0 +1,77 @@
+/**
+ * ASTIndex.h
+ *
+ * An index of a parsed tree, answering queries about nonterminals without walking the whole tree.
+ * Nodes are numbered by their position in a preorder traversal (i.e. in document order), and the
+ * index records the parent of each node along with the positions of every nonterminal of each
+ * rule. Finding the nodes of a rule thus takes time proportional to the number found.
+ *
+ * The index is built in a single traversal (see AST::Iterator), after the tree is complete; during
+ * the parse, backtracking may yet discard any node. Nodes shared by several parents (see
+ * ParseOptions::share_nodes) are indexed once for every parent, each at its own position.
+ *
+ * Span queries expect the spans recorded by the parser, under which nonterminals of the same rule
+ * never begin before those preceding them in document order.
+ */
+
+#ifndef SAGE_AST_INDEX_H
+#define SAGE_AST_INDEX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AST.h"
+
+namespace sage
+{
+    class ASTIndex
+    {
+        public:
+
+            // Returned by queries finding no node
+            static const unsigned long NO_NODE = static_cast<unsigned long>(-1);
+
+            // The index refers to (and keeps alive) the passed tree
+            ASTIndex(std::shared_ptr<AST>);
+
+            // Number of indexed nodes, and the node at the given position
+            unsigned long size() const;
+            const AST& getNode(unsigned long) const;
+
+            // The rule nonterminals of the given type belong to, or Tracer::NO_RULE if none
+            // are part of the tree
+            unsigned int getRule(const std::string&) const;
+
+            // Positions of every nonterminal of the given rule, in document order
+            const std::vector<unsigned long>& findAll(unsigned int) const;
+
+            // Position of the first nonterminal of the given rule lying within the given span
+            // (from its start up to, but excluding, its end)
+            unsigned long findFirst(unsigned int, long, long) const;
+
+            // Position of the parent of the given node, and of its nearest ancestor of the
+            // given rule. The root has no parent.
+            unsigned long getParent(unsigned long) const;
+            unsigned long getAncestor(unsigned long, unsigned int) const;
+
+        private:
+
+            std::shared_ptr<AST> root;
+
+            // Nodes in preorder, along with the position of their parents
+            struct Entry
+            {
+                const AST* node;
+                unsigned long parent;
+            };
+            std::vector<Entry> nodes;
+
+            // Positions of nonterminals, indexed by rule
+            std::vector<std::vector<unsigned long>> rules;
+            std::map<std::string, unsigned int> types;
+    };
+}
+
+#endif //SAGE_AST_INDEX_H
@@ -0,0 +1,133 @@
+/**
+ * ASTReader.h
+ *
+ * Reads a tree written by AST::serialize in place, without rebuilding it. The serialized form
+ * consists of a header followed by every node in preorder:
+ *
+ * - Header: AST_MAGIC, the number of nodes, and the table of types (each a 16-bit rule, a 32-bit
+ *   length and the name), such that the name of a rule is written only once.
+ * - Node: A byte holding the tag (and whether the node covers any input), followed by the start
+ *   of its span (relative to the start of its parent, see @zigzag) and the length of its span
+ *   if it covers any input. Terminals follow with the length of the token and the token itself;
+ *   nonterminals with the index of their type; branches with their number of children. Both of
+ *   the latter then give the number of bytes their children occupy, followed by the children.
+ *
+ * Integers within nodes (save the 32-bit sizes of children) are variable length integers of 7
+ * bits per byte, so that most nodes take only a few bytes. The header holds 32-bit integers
+ * besides the rules. Fixed width integers are little endian, so that the serialized form reads
+ * the same on any machine.
+ *
+ * The children sizes allow skipping from one child to the next. The reader refers to the passed
+ * data, which must outlive it (and every Node read from it). Nodes are validated as they are
+ * read, throwing InvalidAST if malformed.
+ */
+
+#ifndef SAGE_AST_READER_H
+#define SAGE_AST_READER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AST.h"
+#include "InvalidAST.h"
+
+// Identifies serialized trees (and the version of their format)
+#define AST_MAGIC "SAGEAST1"
+
+namespace sage
+{
+    class ASTReader
+    {
+        public:
+
+            // Flag of the leading byte of a node, set if the node covers any input
+            static const std::uint8_t FLAG_SPAN = 0x4;
+
+            // A node of the serialized tree, mirroring the getters of AST
+            class Node
+            {
+                friend class ASTReader;
+
+                public:
+                    AST::AST_TAG getTag() const;
+                    unsigned int getRule() const;
+                    long getStart() const;
+                    long getEnd() const;
+
+                    // The type of nonterminals and token of terminals. The text is not copied,
+                    // but points into the serialized data (and is not null terminated).
+                    const char* getText() const;
+                    unsigned long getTextLength() const;
+                    std::string getString() const;
+
+                    // Children are found by skipping over the subtrees of the children before
+                    // them, so visiting children in turn is best done through @getNextSibling.
+                    unsigned long getChildCount() const;
+                    Node getChild(unsigned long) const;
+                    bool hasNextSibling() const;
+                    Node getNextSibling() const;
+
+                private:
+                    Node(const ASTReader&, unsigned long, unsigned long, long);
+
+                    const ASTReader* reader;
+                    AST::AST_TAG tag;
+                    unsigned int rule;
+                    long start;
+                    long end;
+                    const char* text;
+                    unsigned long text_length;
+                    unsigned long children;
+
+                    // Offsets of the first child, of the byte following the subtree, and
+                    // of the byte following the subtree of the parent
+                    unsigned long first_child;
+                    unsigned long next;
+                    unsigned long parent_end;
+                    long parent_start;
+            };
+
+            // Expects the entirety of the serialized tree
+            ASTReader(const char*, unsigned long);
+
+            // Number of nodes in the tree
+            unsigned long size() const;
+
+            Node getRoot() const;
+
+            // Fixed width integers of the given number of bytes, as used by the format
+            static void writeFixed(std::string&, std::uint32_t, unsigned long = sizeof(std::uint32_t));
+
+            // Variable length integers, as used by the format
+            static void writeVarint(std::string&, unsigned long);
+            static unsigned long readVarint(const char*, unsigned long, unsigned long&);
+
+            // Maps signed integers onto unsigned ones, such that small magnitudes stay small
+            static unsigned long zigzag(long);
+            static long unzigzag(unsigned long);
+
+        private:
+
+            const char* data;
+            unsigned long length;
+            unsigned long nodes;
+
+            // Offset of the root node
+            unsigned long root;
+
+            // Rules and names, indexed as referred to by nonterminals
+            struct Type
+            {
+                unsigned int rule;
+                const char* name;
+                unsigned long length;
+            };
+            std::vector<Type> types;
+
+            // Reads a fixed width integer at the given offset (ending by the given limit), advancing it
+            std::uint32_t readFixed(unsigned long&, unsigned long, unsigned long = sizeof(std::uint32_t)) const;
+    };
+}
+
+#endif //SAGE_AST_READER_H
@@ -0,0 +1,63 @@
+/**
+ * Inflate.h
+ *
+ * A stream buffer decompressing the content of another stream buffer as it is read, such that
+ * compressed input can be scanned (and parsed) directly, without decompressing it to disk first.
+ * Both gzip and zlib streams are accepted, and concatenated gzip members are read as one. As
+ * with gzip(1), anything following the last member that is not another member is ignored.
+ *
+ * Only decompressed chunks are handed to the scanner, which buffers and discards them like any
+ * other input; backtracking thus never requires decompressing content again.
+ *
+ * Decompression is only available if Sage is compiled with SAGE_ZLIB defined (and linked with
+ * -lz). Otherwise this header declares nothing.
+ */
+
+#ifndef SAGE_INFLATE_H
+#define SAGE_INFLATE_H
+
+#ifdef SAGE_ZLIB
+
+#include <streambuf>
+#include <string>
+
+#include <zlib.h>
+
+#include "macro.h"
+
+#include "InputError.h"
+
+namespace sage
+{
+    class Inflate : public std::streambuf
+    {
+        public:
+            Inflate(std::streambuf&, unsigned long = SCANNER_CHUNK_SIZE);
+            ~Inflate();
+            Inflate(const Inflate&) = delete;
+            Inflate& operator= (const Inflate&) = delete;
+
+        protected:
+
+            // Decompresses the next chunk, throwing InputError if the input is corrupt or truncated
+            virtual int_type underflow();
+            virtual std::streamsize showmanyc();
+
+        private:
+
+            // The compressed source, and the chunks last read from and decompressed out of it
+            std::streambuf& source;
+            std::string compressed;
+            std::string decompressed;
+
+            z_stream stream;
+            bool finished;
+
+            // Whether another gzip member follows the one just ended
+            bool hasMember();
+    };
+}
+
+#endif //SAGE_ZLIB
+
+#endif //SAGE_INFLATE_H
@@ -0,0 +1,29 @@
+/**
+ * InputError.h
+ *
+ * The exception raised when input cannot be read at all, such as a file that cannot be opened or
+ * compressed input that is corrupt (see Inflate). Unlike a ScanException, which merely reports
+ * that the input did not match and is recovered from by backtracking, an InputError always ends
+ * the parse.
+ */
+
+#ifndef SAGE_INPUT_ERROR_H
+#define SAGE_INPUT_ERROR_H
+
+#include <exception>
+#include <string>
+
+namespace sage
+{
+    class InputError : public std::exception
+    {
+        public:
+            InputError(std::string);
+            virtual const char* what() const noexcept;
+
+        private:
+            std::string response;
+    };
+}
+
+#endif //SAGE_INPUT_ERROR_H
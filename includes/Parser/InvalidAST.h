@@ -0,0 +1,27 @@
+/**
+ * InvalidAST.h
+ *
+ * The exception raised when reading a serialized tree that is malformed (see ASTReader), or
+ * when writing a tree too large for the serialized form (see AST::serialize).
+ */
+
+#ifndef SAGE_INVALID_AST_H
+#define SAGE_INVALID_AST_H
+
+#include <exception>
+#include <string>
+
+namespace sage
+{
+    class InvalidAST : public std::exception
+    {
+        public:
+            InvalidAST(std::string);
+            virtual const char* what() const noexcept;
+
+        private:
+            std::string response;
+    };
+}
+
+#endif //SAGE_INVALID_AST_H
@@ -0,0 +1,67 @@
+/**
+ * Lexer.h
+ *
+ * The lexer splits an entire input into tokens before any parsing takes place. At each
+ * position (after skipping delimiter characters) the longest substring accepted by any
+ * expression of a RegexSet is taken as the next token (maximal munch).
+ *
+ * Because terminals of a PEG may overlap (e.g. "a" and "[a-z]"), a token is not assigned a
+ * single expression. Instead its kind refers to the set of all expressions accepting the
+ * token, such that a terminal matches a token if it belongs to the token's kind. This is
+ * used by the Scanner when operating on tokens rather than on the raw stream.
+ */
+
+#ifndef SAGE_LEXER_H
+#define SAGE_LEXER_H
+
+#include <istream>
+#include <iterator>
+#include <unordered_map>
+
+#include "macro.h"
+
+#include "Regex/RegexSet.h"
+
+namespace sage
+{
+    // A lexed token, referring to a portion of the lexed text
+    struct Token
+    {
+        unsigned int kind;
+        unsigned long offset;
+        unsigned long length;
+    };
+
+    class Lexer
+    {
+        public:
+
+            // Constructors
+            // Note the set should not be modified once passed to the lexer
+            Lexer(std::shared_ptr<RegexSet>, std::string=REGEX_EXPR_WHITESPACE);
+
+            // Reads in the remainder of the stream into the passed text and splits it into tokens.
+            // Returns false if some portion of the text could not be lexed, in which case the
+            // tokens up to this portion are still provided.
+            bool tokenize(std::istream&, std::string&, std::vector<Token>&);
+
+            // Whether the expression at the given index of the set accepts the token
+            bool accepts(const Token&, unsigned int) const;
+
+        private:
+
+            // The set of expressions tokens are built from
+            std::shared_ptr<RegexSet> terminals;
+
+            // Marks which characters are regarded as delimiters between tokens
+            bool delimiters[256];
+
+            // Each kind is a distinct set of accepted expressions, represented as a mask over
+            // the indices of the set. Kinds are discovered as tokens are encountered and are keyed
+            // by the accepting vector reported by the set.
+            std::vector<std::vector<bool>> kinds;
+            std::unordered_map<const std::vector<unsigned int>*, unsigned int> kind_ids;
+    };
+}
+
+#endif //SAGE_LEXER_H
@@ -0,0 +1,46 @@
+/**
+ * LineIndex.h
+ *
+ * The offsets of all newlines read by a scanner, such that the line and column of any
+ * offset can be found by binary search. The index is extended as content is read, so
+ * scanning itself never needs to track lines and columns. Newlines before content the
+ * scanner has discarded are dropped along with it, keeping only their count.
+ */
+
+#ifndef SAGE_LINE_INDEX_H
+#define SAGE_LINE_INDEX_H
+
+#include <vector>
+
+#include "ScanState.h"
+
+namespace sage
+{
+    class LineIndex
+    {
+        public:
+            LineIndex();
+
+            // Records the newlines of the given content, which directly follows the
+            // content appended before
+            void append(const char*, unsigned long);
+            void clear();
+
+            // Drops the newlines before the given offset, after which only offsets from there
+            // onward may be located
+            void discard(unsigned long);
+
+            // The line and column of the given offset (which need not have been appended yet,
+            // provided no newlines lie between it and the content appended so far)
+            ScanState locate(unsigned long) const;
+
+        private:
+            std::vector<unsigned long> newlines;
+            unsigned long length;
+
+            // Number of newlines dropped from the front of @newlines
+            unsigned long dropped;
+    };
+}
+
+#endif //SAGE_LINE_INDEX_H
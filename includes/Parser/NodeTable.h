@@ -0,0 +1,77 @@
+/**
+ * NodeTable.h
+ *
+ * Hash-consing of nonterminal nodes (see ParseOptions::share_nodes). The result of a rule in a PEG
+ * depends only on the position at which it is attempted, so a node is identified by its rule and
+ * where it begins. When backtracking attempts a rule at a position it was attempted at before, the
+ * node built the first time (or the failure) is returned again, rather than the rule being parsed
+ * and wrapped anew. Structurally identical subtrees are thus the very same node, and may be
+ * compared by pointer.
+ *
+ * Like a Budget, a table is active for the parse performed by the current thread while attached.
+ * Nodes are kept alive by the table until it is destroyed at the end of the parse.
+ */
+
+#ifndef SAGE_NODE_TABLE_H
+#define SAGE_NODE_TABLE_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "AST.h"
+
+namespace sage
+{
+    class NodeTable
+    {
+        public:
+
+            // The result of attempting a rule, and the scanner mark it ended at (see Scanner::getMark)
+            struct Entry
+            {
+                std::shared_ptr<AST> node;
+                unsigned long end;
+            };
+
+            NodeTable();
+            NodeTable(const NodeTable&) = delete;
+            NodeTable& operator= (const NodeTable&) = delete;
+
+            // Makes the passed table (or none, if nullptr) active for as long as the attachment exists
+            class Attachment
+            {
+                public:
+                    Attachment(NodeTable*);
+                    ~Attachment();
+                    Attachment(const Attachment&) = delete;
+                    Attachment& operator= (const Attachment&) = delete;
+
+                private:
+                    NodeTable* previous;
+            };
+
+            // Whether a table is active, i.e. whether nodes are shared
+            static bool isActive();
+
+            // The entry of the given rule at the given mark in the active table, if any
+            static const Entry* find(unsigned int, unsigned long);
+
+            // Records the result of a rule at the given mark in the active table (if any)
+            static void insert(unsigned int, unsigned long, std::shared_ptr<AST>, unsigned long);
+
+            // Number of times a rule was not parsed again, as its result was found instead
+            unsigned long getHits() const;
+
+        private:
+
+            static thread_local NodeTable* active;
+
+            // Entries keyed by mark and rule (see @key)
+            std::unordered_map<unsigned long, Entry> entries;
+            unsigned long hits;
+
+            static unsigned long key(unsigned int, unsigned long);
+    };
+}
+
+#endif //SAGE_NODE_TABLE_H
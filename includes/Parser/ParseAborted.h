@@ -0,0 +1,45 @@
+/**
+ * ParseAborted.h
+ *
+ * The exception raised when a parse is abandoned before completing, as it exceeded one of the
+ * limits of its ParseOptions or was cancelled. This is distinct from a parse failing (in which
+ * case Parser::parse returns a nullptr), since the input may well be valid.
+ */
+
+#ifndef SAGE_PARSE_ABORTED_H
+#define SAGE_PARSE_ABORTED_H
+
+#include <exception>
+#include <string>
+
+namespace sage
+{
+    class ParseAborted : public std::exception
+    {
+        public:
+
+            // The limit responsible for abandoning the parse
+            enum ABORT_REASON
+            {
+                ABORT_STEPS,        // The step budget was exhausted
+                ABORT_DEADLINE,     // The deadline passed
+                ABORT_MEMORY,       // The memory ceiling was exceeded
+                ABORT_CANCELLED     // The cancellation token was set
+            };
+
+            ParseAborted(ABORT_REASON, unsigned long);
+            virtual const char* what() const noexcept;
+
+            ABORT_REASON getReason() const;
+
+            // The number of steps taken before abandoning the parse
+            unsigned long getSteps() const;
+
+        private:
+            ABORT_REASON reason;
+            unsigned long steps;
+            std::string response;
+    };
+}
+
+#endif //SAGE_PARSE_ABORTED_H
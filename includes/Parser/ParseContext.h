@@ -0,0 +1,48 @@
+/**
+ * ParseContext.h
+ *
+ * State kept between parses of many (typically small) documents, such that setting up each parse
+ * costs next to nothing. The context owns the stream documents are read from and the Scanner
+ * reading it, which are reset rather than rebuilt for each document. The scanner's checkpoint
+ * stack, match cache and lexed token buffers thus retain their allocations, and its delimiter
+ * need not be looked up again.
+ *
+ * A context may be used with any Parser, but is rebuilt whenever used with a different Parser
+ * than before. It must not be shared between threads.
+ */
+
+#ifndef SAGE_PARSE_CONTEXT_H
+#define SAGE_PARSE_CONTEXT_H
+
+#include <memory>
+#include <sstream>
+
+#include "Scanner.h"
+
+namespace sage
+{
+    class Parser;
+
+    class ParseContext
+    {
+        // Manages the members below
+        friend class Parser;
+
+        public:
+            ParseContext();
+            ParseContext(const ParseContext&) = delete;
+            ParseContext& operator= (const ParseContext&) = delete;
+
+        private:
+
+            // The stream holding the current document, and the scanner reading it (built on
+            // first use). Note the scanner refers to @buffer, so the context cannot be moved.
+            std::stringstream buffer;
+            std::unique_ptr<Scanner> scanner;
+
+            // The parser @scanner was built for
+            const Parser* owner;
+    };
+}
+
+#endif //SAGE_PARSE_CONTEXT_H
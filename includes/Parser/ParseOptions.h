@@ -0,0 +1,88 @@
+/**
+ * ParseOptions.h
+ *
+ * Limits placed upon a single parse. Since PEGs backtrack, some grammars take exponential time
+ * on certain inputs; these limits ensure such a parse is abandoned (by throwing ParseAborted)
+ * rather than running indefinitely. By default no limits apply.
+ *
+ * - Steps: Every attempt at parsing a definition (see Definition::parse), and every repetition
+ *   of a repeated definition, counts as a step.
+ * - Deadline: The point in time after which the parse is abandoned.
+ * - Memory: The number of bytes allocated for AST nodes and memoized matches. Note this counts
+ *   every allocation made over the course of the parse, including those of nodes discarded
+ *   when backtracking, and is thus an upper bound of the memory in use at any one time.
+ * - Cancellation: A flag which may be set from another thread to abandon the parse.
+ *
+ * The budget of a parse is consulted on every step, but the clock and cancellation token are
+ * only read every so often (see PARSE_CHECK_INTERVAL) to keep checks cheap.
+ *
+ * Besides limits, the options control how the tree is built:
+ *
+ * - Sharing: Each nonterminal node is built once per rule and position, and shared wherever
+ *   the rule is attempted at that position again (see NodeTable). Off by default.
+ * - Flattening: Sequences and repetitions append their nodes to those of the enclosing rule
+ *   instead of building branches of them, and missing optional elements build nothing. Only
+ *   rules then nest, each as shaped by its annotation (see Definition::RULE_ANNOTATION). Off
+ *   by default.
+ */
+
+#ifndef SAGE_PARSE_OPTIONS_H
+#define SAGE_PARSE_OPTIONS_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "ParseAborted.h"
+
+// Number of steps between consulting the clock and cancellation token
+#define PARSE_CHECK_INTERVAL 256
+
+namespace sage
+{
+    struct ParseOptions
+    {
+        ParseOptions();
+
+        // Convenience method to set the deadline relative to now
+        ParseOptions& setTimeout(std::chrono::milliseconds);
+
+        unsigned long max_steps;
+        std::chrono::steady_clock::time_point deadline;
+        unsigned long max_memory;
+        std::shared_ptr<std::atomic<bool>> cancel;
+        bool share_nodes;
+        bool flatten;
+    };
+
+    // Enforces the options of the parse performed by the current thread, for as long as it exists
+    class Budget
+    {
+        public:
+            Budget(const ParseOptions&);
+            ~Budget();
+            Budget(const Budget&) = delete;
+            Budget& operator= (const Budget&) = delete;
+
+            // Record a step or allocation of the active budget (if any), throwing ParseAborted
+            // if a limit has been reached
+            static void step();
+            static void allocate(unsigned long);
+
+        private:
+
+            // The budget of the current thread's parse, if any
+            static thread_local Budget* active;
+            Budget* previous;
+
+            const ParseOptions& options;
+            unsigned long steps;
+            unsigned long memory;
+
+            // The step at which @check is next called
+            unsigned long next_check;
+            void check();
+    };
+}
+
+#endif //SAGE_PARSE_OPTIONS_H
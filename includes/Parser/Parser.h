@@ -10,6 +10,20 @@
  * definitions. Since backtracking needs to be employed anyways, I simply encapsulate each
  * definition and apply each one.
  *
+ * A grammar may also declare the tokens of the language it describes, via a statement such as:
+ *
+ * %tokens "[0-9]+" "[+\-]";
+ *
+ * In this case the input is first split into tokens in a single pass, and terminals are then
+ * matched against these tokens rather than against the raw input (see Lexer).
+ *
+ * Rules may be annotated to shape their nodes in flattened trees (see ParseOptions::flatten and
+ * Definition::RULE_ANNOTATION), via statements such as:
+ *
+ * %inline Value;
+ * %transparent Sum Product;
+ * %leaf Number;
+ *
  * Created by jrpotter (12/05/2015).
  */
 
@@ -20,6 +34,10 @@
 
 #include "macro.h"
 
+#include "Inflate.h"
+#include "InputError.h"
+#include "ParseContext.h"
+#include "ReadAhead.h"
 #include "Scanner.h"
 #include "InvalidGrammar.h"
 #include "PEG/Choices.h"
@@ -30,12 +48,53 @@ namespace sage
     {
         public:
 
+            // Options controlling how the grammar is compiled. These may be or'ed together.
+            enum PARSER_OPTION
+            {
+                OPTION_NONE             = 0,        // Each terminal runs its own Regex
+                OPTION_MULTI_PATTERN    = 1 << 0,   // All terminals are compiled into one automaton
+                OPTION_TOKEN_STREAM     = 1 << 1,   // Input is lexed before parsing (implies the above)
+                OPTION_UTF8             = 1 << 2    // Terminals are read as UTF-8 (see Regex::FLAG_UTF8)
+            };
+
             // Constructors (expect filename of .peg file)
-            Parser(std::string);
+            Parser(std::string, int = OPTION_NONE);
             ~Parser();
 
-            // Constructs an AST from stream (usually a file stream)
-            std::shared_ptr<AST> parse(std::istream&);
+            // Constructs an AST from stream (usually a file stream). Throws ParseAborted if
+            // the parse exceeds any of the passed limits.
+            std::shared_ptr<AST> parse(std::istream&, const ParseOptions& = ParseOptions());
+
+            // Parses the named file, which is read on a background thread while parsing (see
+            // ReadAhead). Gzip files are decompressed on the fly if built with SAGE_ZLIB (see
+            // Inflate). Throws InputError if the file cannot be opened or decompressed.
+            std::shared_ptr<AST> parseFile(const std::string&, const ParseOptions& = ParseOptions());
+
+            // Parses a document held in memory, reusing the passed context between calls. This
+            // is much cheaper than the above when parsing many small documents.
+            std::shared_ptr<AST> parse(ParseContext&, const std::string&, const ParseOptions& = ParseOptions());
+
+            // Parses each document in turn (with a single context), applying the passed options
+            // to each document separately. A nullptr is returned for every document not parsed.
+            // Note if any parse is aborted, the exception propagates and the batch is abandoned.
+            std::vector<std::shared_ptr<AST>> parseBatch(const std::vector<std::string>&,
+                                                         const ParseOptions& = ParseOptions());
+
+            // Statistics of all parses so far (only gathered if compiled with SAGE_PROFILE)
+            Profiler& getProfiler();
+
+            // Recent events of parses (only gathered once enabled)
+            Tracer& getTracer();
+
+            // I/O and matching performed by the most recent parse (always gathered)
+            struct Counters
+            {
+                Scanner::Counters scanner;
+                Regex::Counters regex;
+                unsigned long shared_nodes;     // Rules not parsed again (see NodeTable)
+                Counters();
+            };
+            const Counters& getCounters() const;
 
         private:
 
@@ -48,8 +107,39 @@ namespace sage
             std::string start;
             symbol_table table;
 
+            // Flags every terminal of the grammar is constructed with
+            int regex_flags;
+
+            // Set of all terminals in the grammar (if OPTION_MULTI_PATTERN is specified)
+            std::shared_ptr<RegexSet> terminals;
+
+            // Tokens declared by the grammar (via the tokens directive). If the grammar declares
+            // any tokens, or OPTION_TOKEN_STREAM is specified, a lexer is built from the declared
+            // tokens followed by all other terminals of the grammar.
+            std::vector<std::string> tokens;
+            std::shared_ptr<Lexer> lexer;
+
+            // Annotations of rules declared by the grammar (via the inline, transparent and leaf
+            // directives)
+            std::map<std::string, Definition::RULE_ANNOTATION> annotations;
+
+            // Records each parse (see @Profiler)
+            Profiler profiler;
+
+            // See @getCounters
+            Counters counters;
+
+            // Records recent events of each parse. Rules are identified by their index in @table.
+            Tracer tracer;
+            unsigned int start_rule;
+
+            // Parses the content of the passed scanner according to the grammar
+            std::shared_ptr<AST> parse(Scanner&, const ParseOptions&);
+
             // Used to actually manipulate and read in the given file
             void initializeTable(Scanner&);
+            void readDirective(Scanner&);
+            void readAnnotation(Scanner&, Definition::RULE_ANNOTATION);
     };
 }
 
@@ -0,0 +1,131 @@
+/**
+ * Profiler.h
+ *
+ * Records where time is spent while parsing, per rule (i.e. per nonterminal) of the grammar. For
+ * every rule we track the number of invocations, how many succeeded or failed, the number of bytes
+ * consumed by successful invocations, checkpoint restores (backtracking) within the rule, and the
+ * time spent both inclusively (including nested rules) and exclusively.
+ *
+ * Profiling is only performed if Sage is compiled with SAGE_PROFILE defined. Otherwise the macros
+ * below expand to nothing, and parsing is not slowed down at all. When enabled, each Parser owns
+ * a profiler which is active (for the current thread) over the course of a parse. Results accumulate
+ * over multiple parses until reset.
+ *
+ * Results can be written out as a report sorted by exclusive time, or as collapsed stacks (one line
+ * per unique stack of rules, followed by the exclusive nanoseconds spent) as consumed by flamegraph.pl.
+ */
+
+#ifndef SAGE_PROFILER_H
+#define SAGE_PROFILER_H
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Scanner.h"
+
+#ifdef SAGE_PROFILE
+    #define SAGE_PROFILE_ATTACH(profiler) Profiler::Attachment sage_profile_attachment(profiler)
+    #define SAGE_PROFILE_RULE(guard, rule, scanner) Profiler::Rule guard(rule, scanner)
+    #define SAGE_PROFILE_SUCCEED(guard) guard.succeed()
+    #define SAGE_PROFILE_RESTORE() Profiler::restore()
+#else
+    #define SAGE_PROFILE_ATTACH(profiler)
+    #define SAGE_PROFILE_RULE(guard, rule, scanner)
+    #define SAGE_PROFILE_SUCCEED(guard)
+    #define SAGE_PROFILE_RESTORE()
+#endif
+
+namespace sage
+{
+    class Profiler
+    {
+        public:
+
+            // Statistics gathered for a single rule
+            struct Statistics
+            {
+                unsigned long invocations;
+                unsigned long successes;
+                unsigned long failures;
+                unsigned long restores;
+                unsigned long bytes;
+                unsigned long long inclusive_ns;
+                unsigned long long exclusive_ns;
+                Statistics();
+            };
+
+            // Makes the passed profiler active for the current thread, until destroyed
+            class Attachment
+            {
+                public:
+                    Attachment(Profiler&);
+                    ~Attachment();
+
+                private:
+                    Profiler* previous;
+            };
+
+            // Tracks a single invocation of a rule, until destroyed. The invocation is
+            // regarded as failed unless @succeed is called beforehand.
+            class Rule
+            {
+                public:
+                    Rule(const std::string&, Scanner&);
+                    ~Rule();
+                    void succeed();
+
+                private:
+                    Scanner& scanner;
+                    bool success;
+            };
+
+            // Constructors
+            Profiler() = default;
+
+            // Records a checkpoint restore within the innermost rule of the active profiler
+            static void restore();
+
+            // Accessors
+            const std::map<std::string, Statistics>& getStatistics() const;
+            void reset();
+
+            // Output
+            void report(std::ostream&) const;
+            void collapsed(std::ostream&) const;
+
+        private:
+
+            // A rule currently being processed
+            struct Frame
+            {
+                Statistics* statistics;
+                std::chrono::steady_clock::time_point begin;
+                unsigned long long child_ns;
+                long position;
+                unsigned long path_length;
+            };
+
+            // The profiler recording the current thread's parse, if any
+            static thread_local Profiler* active;
+
+            // Statistics by rule, and exclusive time by stack of rules (joined by ';')
+            std::map<std::string, Statistics> statistics;
+            std::unordered_map<std::string, unsigned long long> stacks;
+
+            // The rules currently being processed, and their names joined as above. Recursive
+            // rules only accrue inclusive time in their outermost invocation (tracked by @depths).
+            std::vector<Frame> frames;
+            std::string path;
+            std::unordered_map<const Statistics*, unsigned long> depths;
+
+            void enter(const std::string&, long);
+            void exit(bool, long);
+    };
+}
+
+#endif //SAGE_PROFILER_H
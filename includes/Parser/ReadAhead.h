@@ -0,0 +1,72 @@
+/**
+ * ReadAhead.h
+ *
+ * A stream buffer over a file, which reads the file on a background thread. While the scanner
+ * works on one chunk, the following chunks (up to READ_AHEAD_DEPTH of them) are read in the
+ * meantime, so that parsing a file not yet in the page cache need not wait on each read in turn.
+ *
+ * The buffer is meant to be read sequentially by a single thread (e.g. through a Scanner), and
+ * does not support seeking or putting characters back beyond the current chunk.
+ */
+
+#ifndef SAGE_READ_AHEAD_H
+#define SAGE_READ_AHEAD_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "macro.h"
+
+namespace sage
+{
+    class ReadAhead : public std::streambuf
+    {
+        public:
+            ReadAhead(const std::string&, unsigned long = SCANNER_CHUNK_SIZE, unsigned int = READ_AHEAD_DEPTH);
+            ~ReadAhead();
+            ReadAhead(const ReadAhead&) = delete;
+            ReadAhead& operator= (const ReadAhead&) = delete;
+
+            // Indicates whether the file could be opened
+            bool is_open() const;
+
+        protected:
+
+            // Hands out the next chunk read, waiting for it if necessary
+            virtual int_type underflow();
+
+            // The size of the next chunk if already read (see std::streambuf::in_avail)
+            virtual std::streamsize showmanyc();
+
+        private:
+
+            // Only the worker touches @file once started, hence @opened
+            std::ifstream file;
+            bool opened;
+            unsigned long chunk_size;
+            unsigned int depth;
+
+            // Chunks read but not yet handed out, and the chunk currently being consumed
+            std::deque<std::string> chunks;
+            std::string current;
+
+            // @finished is set once the worker reaches the end of the file, and @stopping
+            // when the buffer is destroyed before then
+            bool finished;
+            bool stopping;
+            std::mutex mutex;
+            std::condition_variable produced;
+            std::condition_variable consumed;
+            std::thread worker;
+
+            // Reads chunks until the end of the file, staying at most @depth chunks ahead
+            void readChunks();
+    };
+}
+
+#endif //SAGE_READ_AHEAD_H
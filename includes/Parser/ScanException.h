@@ -19,6 +19,7 @@ namespace sage
     class ScanException : public std::exception
     {
         public:
+            ScanException(std::string);
             ScanException(std::string, ScanState);
             virtual const char* what() const noexcept;
 
@@ -3,8 +3,19 @@
  *
  * Note the scanner is a wrapper around an istream object. As such, it is important
  * the stream the scanner is referring to stays in memory during the usage of the scanner.
- * The scanner will read in characters from the stream according to the regular expression
- * being used to search.
+ * Characters are pulled from the stream into a buffer as they are needed, and all scanning
+ * (and backtracking) then takes place within the buffer. The scanner may thus read further
+ * ahead in the stream than it has consumed, but never blocks waiting on content it does
+ * not yet need. The stream is never seeked, so pipes and other non-seekable streams are
+ * read like any other.
+ *
+ * Content before the oldest checkpoint can never be returned to, and is discarded from the
+ * buffer as more is read. The buffer thus only spans the region reachable by checkpoints
+ * (plus the chunk being read), and offsets continue to refer to the input as a whole.
+ *
+ * Alternatively the scanner can be constructed with a Lexer, in which case the entire
+ * stream is split into tokens up front. Only the set scanning methods and checkpoints
+ * are then available, and operate on tokens instead of characters.
  *
  * Created by jrpotter (11/26/2015).
  */
@@ -13,11 +24,17 @@
 
 #include <istream>
 #include <memory>
-#include <stack>
+#include <unordered_map>
+#include <vector>
 
+#include "macro.h"
 #include "string.h"
 
 #include "Regex/Regex.h"
+#include "Regex/RegexSet.h"
+#include "Lexer.h"
+#include "LineIndex.h"
+#include "ParseOptions.h"
 #include "ScanException.h"
 #include "ScanState.h"
 
@@ -29,6 +46,14 @@ namespace sage
 
             // Constructors
             Scanner(std::istream&, std::string=REGEX_EXPR_WHITESPACE);
+            Scanner(std::istream&, std::shared_ptr<Lexer>);
+
+            // Discards all state, and begins scanning the stream anew from its current position
+            // (as though just constructed). Buffers are kept for reuse.
+            void reset();
+
+            // Indicates whether any content remains to be read
+            bool hasNext();
 
             // Scanning Methods
             int nextInt();
@@ -36,31 +61,103 @@ namespace sage
             char nextLetter();
             double nextDouble();
             std::string nextWord();
-            std::string next(Regex);
+            std::string next(const Regex&);
+
+            // Set Scanning Methods
+            // Tests/reads the expression at the given index of the set. All expressions of
+            // the set are matched at once, and the results are cached by stream position.
+            bool hasNext(RegexSet&, unsigned int);
+            std::string next(RegexSet&, unsigned int);
             std::string readLine();
             std::string readUntil(char);
 
             // Direct Methods
             char read();
-            char peek(int = 0);
+            int peek(int = 0);
 
             // Checkpoints
-            // Allows returning back to a given state
+            // Allows returning back to the position at which a checkpoint was saved. Restoring
+            // or releasing a checkpoint discards it along with all checkpoints saved after it.
+            // An index of 0 refers to the most recently saved checkpoint.
             unsigned long saveCheckpoint();
+            void restoreCheckpoint(unsigned long = 0);
+            void releaseCheckpoint(unsigned long = 0);
+
+            // The line and column of the next byte to be read. These are not tracked while
+            // scanning, but determined when requested (e.g. when reporting an error).
             ScanState getCurrentState() const;
-            std::stack<ScanState> restoreCheckpoint(unsigned long = 0);
+
+            // The offset of the next byte to be read from the input
+            long getPosition() const;
+
+            // The value a checkpoint saved now would hold (an offset, or a token index in token
+            // mode), and a means of moving ahead to such a value. Only marks reached before may
+            // be moved ahead to, since the content up to them is known to be buffered.
+            unsigned long getMark() const;
+            void advanceTo(unsigned long);
+
+            // Counts of the I/O performed on the input. Each byte is read from the stream
+            // once; backtracking only moves within the buffer. In token mode, the entire
+            // input is read once when lexing.
+            struct Counters
+            {
+                unsigned long bytes_read;
+                unsigned long bytes_discarded;  // Dropped from the front of the buffer
+                unsigned long saves;            // Checkpoints saved
+                unsigned long restores;         // Checkpoints restored
+                Counters();
+            };
+
+            const Counters& getCounters() const;
+            void resetCounters();
 
         private:
 
             // The input source the scanner will read from
             std::istream& input;
-            std::stack<ScanState> states;
+
+            // The content read from @input and not yet discarded, which begins at offset @base.
+            // @cursor is the offset of the next byte to be consumed, and @exhausted indicates
+            // whether the end of @input has been reached.
+            std::string text;
+            unsigned long base;
+            unsigned long cursor;
+            bool exhausted;
+
+            // Pulls content from @input until @text holds the byte at the given offset,
+            // returning false if the input ends before then
+            bool available(unsigned long);
+
+            // Drops the content before the oldest checkpoint from @text (see @available)
+            void discard();
+
+            // The positions to return to, as offsets into @text (or token indices in token mode)
+            std::vector<unsigned long> checkpoints;
+
+            // The newlines of @text, extended as content is read (see @getCurrentState)
+            LineIndex lines;
+
+            // See @getCounters
+            Counters counters;
 
             // Utility method to clean @next method
-            std::string tokenize(Regex&, std::stack<unsigned int>&);
+            std::string tokenize(const Regex&);
+
+            // Token mode
+            // The tokens of @text and the index of the next token to be read.
+            // If the text could not be lexed entirely, @lexed is false.
+            std::shared_ptr<Lexer> lexer;
+            std::vector<Token> tokens;
+            unsigned long token_cursor;
+            bool lexed;
+
+            // Longest match lengths of each expression of @match_set, keyed by offset
+            const RegexSet* match_set;
+            std::unordered_map<long, std::vector<unsigned long>> match_cache;
+            const std::vector<unsigned long>& matchAll(RegexSet&);
 
             // Represents the Regex matching the separator between tokens
-            // The method is used to remove delimiter content between tokens in stream
+            // The method is used to remove delimiter content between tokens in the input
             Regex delimiter;
             void clearDelimiterContent();
 
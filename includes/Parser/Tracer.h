@@ -0,0 +1,150 @@
+/**
+ * Tracer.h
+ *
+ * Records the most recent events of a parse into a fixed-size ring buffer, so that the cause of a
+ * pathological parse can be inspected after the fact. An event is recorded whenever a rule (i.e. a
+ * nonterminal) is entered, succeeds, fails, or backtracks (restores a checkpoint), alongside the
+ * offset into the input at the time and a timestamp.
+ *
+ * Unlike the Profiler, tracing is always compiled in, but does nothing until enabled. The buffer
+ * is allocated once when enabled, and recording an event then merely overwrites the oldest slot,
+ * without locking or allocating. The buffer may be dumped to a compact binary file at any time,
+ * including from a signal handler (see @dumpOnSignal) or once a parse has exceeded a time limit
+ * (see @dumpOnTimeout). Dumps are read back by the decoder in tools/tracedecode.cpp.
+ *
+ * The file consists of the magic bytes "SAGETRC1", a 32-bit count of rules followed by each rule
+ * name (as a 16-bit length and its bytes), and a 64-bit count of events followed by the events
+ * themselves (oldest first). Integers are written in the byte order of the host.
+ */
+
+#ifndef SAGE_TRACER_H
+#define SAGE_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Scanner.h"
+
+#define TRACER_MAGIC "SAGETRC1"
+
+namespace sage
+{
+    class Tracer
+    {
+        public:
+
+            // The kinds of events recorded
+            enum TRACE_EVENT
+            {
+                EVENT_ENTER     = 0,    // A rule was invoked
+                EVENT_SUCCEED   = 1,    // A rule matched (the offset is where it ended)
+                EVENT_FAIL      = 2,    // A rule did not match
+                EVENT_RESTORE   = 3     // A checkpoint was restored within a rule
+            };
+
+            // Identifies events not belonging to any known rule
+            static const std::uint16_t NO_RULE = 0xFFFF;
+
+            // A single entry of the buffer. The timestamp is in nanoseconds since tracing was enabled.
+            struct Event
+            {
+                std::uint64_t timestamp;
+                std::uint32_t offset;
+                std::uint16_t rule;
+                std::uint8_t type;
+                std::uint8_t reserved;
+            };
+
+            // Makes the passed tracer active for the current thread, until destroyed
+            class Attachment
+            {
+                public:
+                    Attachment(Tracer&);
+                    ~Attachment();
+
+                private:
+                    Tracer* previous;
+            };
+
+            // Records the invocation of a rule, and its outcome once destroyed. The invocation
+            // is regarded as failed unless @succeed is called beforehand.
+            class Rule
+            {
+                public:
+                    Rule(unsigned int, Scanner&);
+                    ~Rule();
+                    void succeed();
+
+                private:
+                    Tracer* tracer;
+                    Scanner& scanner;
+                    bool success;
+            };
+
+            // Constructors
+            Tracer();
+            ~Tracer();
+            Tracer(const Tracer&) = delete;
+            Tracer& operator= (const Tracer&) = delete;
+
+            // Allocates a buffer holding (at least) the given number of most recent events
+            void enable(unsigned long);
+            void disable();
+            bool isEnabled() const;
+
+            // Names of the rules events refer to, by index
+            void setRules(const std::vector<std::string>&);
+
+            // Records a checkpoint restore within the innermost rule of the active tracer
+            static void restore(Scanner&);
+
+            // Writes the buffer out to the given file descriptor or path, returning whether
+            // this succeeded. Both are async-signal-safe.
+            bool dump(int) const;
+            bool dump(const char*) const;
+
+            // Dumps the buffer to the given path once a parse runs longer than the given time.
+            // This is checked whenever an event is recorded, and happens at most once per parse.
+            void dumpOnTimeout(std::chrono::milliseconds, const std::string&);
+
+            // Dumps the buffer to the given path whenever the given signal is received. Only
+            // one tracer may be dumped on signal at a time; installing another replaces it.
+            void dumpOnSignal(int, const std::string&);
+
+        private:
+
+            // The tracer recording the current thread's parse, if any, and the tracer dumped on signal
+            static thread_local Tracer* active;
+            static std::atomic<Tracer*> signalled;
+            static void handleSignal(int);
+
+            // The ring buffer. Only the thread performing the parse ever writes to it; @head
+            // counts the events recorded so far, such that the next slot is @head & @mask.
+            std::unique_ptr<Event[]> events;
+            unsigned long mask;
+            std::atomic<unsigned long> head;
+
+            // Everything preceding the events in a dump (see above), built ahead of time so
+            // that dumping need not allocate
+            std::string header;
+
+            // The rules currently being processed (innermost last)
+            std::vector<std::uint16_t> rules;
+
+            // Timing
+            std::chrono::steady_clock::time_point epoch;
+            std::uint64_t parse_begin;
+            std::uint64_t timeout;
+            bool timed_out;
+            std::string timeout_path;
+            std::string signal_path;
+
+            void record(std::uint16_t, long, TRACE_EVENT);
+    };
+}
+
+#endif //SAGE_TRACER_H
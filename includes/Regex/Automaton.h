@@ -11,13 +11,10 @@
 #ifndef SAGE_AUTOMATON_H
 #define SAGE_AUTOMATON_H
 
-#include <map>
-#include <memory>
-#include <set>
+#include <cstdint>
 #include <string>
 #include <vector>
 
-#include "memory.h"
 #include "interval.h"
 
 namespace sage
@@ -29,15 +26,22 @@ namespace sage
             // Constructors
             Automaton();
             virtual ~Automaton()=0;
-            Automaton(const Automaton&);
+            Automaton(const Automaton&) = default;
             Automaton(Automaton&&);
             void swap(Automaton&, Automaton&);
 
+            // Number of nodes in the automaton
+            unsigned long size() const;
+
+            // Nodes are referred to by their position within @graph. Note 32 bits is plenty,
+            // since an automaton is limited to far fewer states (see REGEX_STATE_LIMIT).
+            using node_id = std::uint32_t;
+
         protected:
 
             // Represents an element in the FA
-            // Note we use weak pointers internally since cycles can crop up
-            // when using Thompson's Construction Algorithm (e.g. Kleene Star)
+            // Since nodes refer to one another by index, cycles (as crop up when using
+            // Thompson's Construction Algorithm, e.g. Kleene Star) require no special care.
             struct Node {
 
                 public:
@@ -48,45 +52,48 @@ namespace sage
                     // modify this property as we continue on
                     bool finish;
 
+                    // When multiple expressions are compiled into one automaton (see @RegexSet), finishing
+                    // nodes are additionally labeled by the indices of the expressions they accept. These
+                    // are kept sorted and are empty for automatons built from a single expression.
+                    std::vector<unsigned int> accepts;
+
                     // @epsilon refers to neighbor edges that can be reached for "free." That is, there is no
                     // requirement to consume a character in order to advance to an NFA in our epsilon vector
-                    std::vector<std::weak_ptr<Node>> epsilon;
+                    std::vector<node_id> epsilon;
 
                     // @ranges represent edges that allow for multiple characters to traverse said edge. Though
                     // initially designed so that each character/string would construct a new edge, this proves
-                    // much to expensive.
-                    IntervalTree<char, std::weak_ptr<Node>> edges;
-
-                    // Constructor
-                    // Note that we do not include the other type of constructors here since
-                    // copying of the node should be done by the automaton in question. This is
-                    // because we need to apply all edges to a corresponding node in the copied
-                    // automaton. Otherwise we'd have a confusing mess of a connected network.
-                    Node(bool);
-
-                    // Returns a collection of nodes corresponding to the epsilon closure
-                    const weak_set<Node> epsilonClosure() const;
+                    // much to expensive. Note edges are keyed by bytes (as opposed to signed chars) so
+                    // that all 256 values can be traversed.
+                    IntervalTree<unsigned char, node_id> edges;
 
-                private:
+                    // Once an automaton will no longer change (i.e. a built DFA), @edges are frozen into a
+                    // flat array which is quicker to search. @edges is then left empty.
+                    IntervalArray<unsigned char, node_id> frozen;
 
-                    // Useful wrapper to actually populate the given set correctly
-                    void epsilonClosure(std::weak_ptr<Node>, weak_set<Node>&) const;
+                    // Freezes the edges of the node (see above)
+                    void freeze();
 
+                    // Constructor
+                    Node(bool);
             };
 
-            // In order to handle cyclic dependencies in the construction of the
-            // FA, the FA contains a shared pointer to all nodes while nodes
-            // contain weak pointer references to one another.
+            // All nodes of the FA, stored contiguously. Copying an automaton is thus just a
+            // matter of copying this vector.
             //
             // When performing an operation that grows the size of the FA, it
-            // will join all nodes into its graph.
-            std::vector<std::shared_ptr<Node>> graph;
+            // will append all nodes onto its graph.
+            std::vector<Node> graph;
 
             // The starting node of the given FA
-            std::weak_ptr<Node> start;
+            node_id start;
 
             // Utility method to construct node
-            std::weak_ptr<Node> buildNode(bool);
+            node_id buildNode(bool);
+
+            // Appends a copy of the nodes of the passed automaton onto our own graph, returning
+            // the offset at which they were placed (i.e. the new index of the first node)
+            node_id absorb(const Automaton&);
     };
 }
 
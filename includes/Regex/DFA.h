@@ -17,8 +17,14 @@
 #ifndef SAGE_DFA_H
 #define SAGE_DFA_H
 
-#include "disjoint.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <tuple>
+
 #include "NFA.h"
+#include "InvalidRegex.h"
+#include "sparse.h"
 
 namespace sage
 {
@@ -27,7 +33,9 @@ namespace sage
         public:
         
             // Constructors
-            DFA(std::shared_ptr<NFA>);
+            // The DFA is minimized once built. Building fails if more states than the passed limit
+            // would be required (which is possible since determinization is exponential at worst).
+            DFA(std::shared_ptr<NFA>, unsigned long = std::numeric_limits<unsigned long>::max());
             virtual ~DFA() = default;
             DFA(const DFA&);
             DFA(DFA&&);
@@ -37,14 +45,42 @@ namespace sage
             // Operations to move through the DFA
             void reset();
             bool final() const;
-            bool traverse(char);
+            bool traverse(unsigned char);
+
+            // Indices of the expressions accepted at the current cursor
+            // (only populated when built from a labeled NFA)
+            const std::vector<unsigned int>& accepting() const;
+
+            // Equivalent operations using a cursor held by the caller, such that a single
+            // DFA may be traversed by many callers (or threads) at once
+            node_id getStart() const;
+            bool final(node_id) const;
+            bool traverse(node_id&, unsigned char) const;
+            const std::vector<unsigned int>& accepting(node_id) const;
+
+            // Approximate number of bytes occupied by the DFA
+            unsigned long bytes() const;
 
         private:
+
+            // A set of NFA nodes corresponding to a single DFA node (kept sorted)
+            using powerset = std::vector<node_id>;
+
+            // Expands the given set of NFA nodes by all nodes reachable via epsilon edges
+            static void epsilonClosure(const NFA&, SparseSet<node_id>&);
+
+            // Merges all equivalent nodes together
+            void minimize();
+
+            // The edges of a node, relabeled by the passed partition of nodes. Adjacent
+            // ranges leading to the same block of the partition are merged together.
+            using transition = IntervalTree<unsigned char, node_id>::interval;
+            std::vector<transition> transitions(const Node&, const std::vector<node_id>&) const;
         
             // The marker specifying the state the DFA is currently on.
             // This should be @reset internally during each call required
             // to traverse the machine.
-            std::weak_ptr<Node> cursor;
+            node_id cursor;
     };
 }
 
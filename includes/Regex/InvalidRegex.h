@@ -9,6 +9,7 @@
 #ifndef SAGE_INVALID_REGEX_H
 #define SAGE_INVALID_REGEX_H
 
+#include <cstdio>
 #include <exception>
 #include <sstream>
 
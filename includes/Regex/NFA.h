@@ -17,8 +17,9 @@
 #ifndef SAGE_NFA_H
 #define SAGE_NFA_H
 
+#include <algorithm>
+
 #include "Automaton.h"
-#include "memory.h"
 
 namespace sage
 {
@@ -30,8 +31,8 @@ namespace sage
 
             // Constructors
             NFA();
-            NFA(char);
-            NFA(char, char);
+            NFA(unsigned char);
+            NFA(unsigned char, unsigned char);
             virtual ~NFA() = default;
             NFA(const NFA&);
             NFA(NFA&&);
@@ -39,11 +40,11 @@ namespace sage
             void swap(NFA&, NFA&);
 
             // Union.
-            // Sets up target NFA as immediately accessible.
+            // Sets up target NFA as immediately accessible. The target is copied into our own.
             void join(std::shared_ptr<NFA>);
 
             // Concatenation
-            // Join two NFAs together.
+            // Join two NFAs together. The target is copied into our own.
             void concatenate(std::shared_ptr<NFA>);
 
             // Operator '*'
@@ -58,13 +59,18 @@ namespace sage
             // The optional operator means the previous character can be included or excluded.
             void makeOptional();
 
+            // Labeling
+            // Marks all finishing nodes as accepting the expression at the given index.
+            // Used when several NFAs are joined into a single multi-accept automaton.
+            void label(unsigned int);
+
         private:
 
             // Indicates the finishing nodes of the given NFA
             // Note it is important that we do not simply label nodes as finished but
             // instead add it to our given set. This allows for quick construction from
-            // multiple NFAs.
-            weak_set<Node> finished;
+            // multiple NFAs. Note the finishing nodes are always distinct.
+            std::vector<node_id> finished;
     };
 }
 
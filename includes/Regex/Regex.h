@@ -14,6 +14,18 @@
  * - \A: Alphabetical Characters ([a-zA-Z])
  * - \w: Alphanumeric Characters ([a-zA-Z0-9])
  *
+ * By default expressions operate on bytes. If constructed with FLAG_UTF8, the expression
+ * is instead regarded as UTF-8 encoded: literals, ranges (e.g. [α-ω]) and the wildcard refer
+ * to entire code points, which are compiled into the equivalent sequences of bytes. Matching
+ * thus still proceeds byte by byte, without decoding the input.
+ *
+ * Counted repetition is supported via {m} (exactly m times), {m,} (at least m times)
+ * and {m,n} (between m and n times). Repetitions may be stacked, each applying to the result
+ * of the last (i.e. a{2}{3} is a{6}). A '{' not followed by a count is read literally.
+ *
+ * Compiled expressions are immutable and shared through the RegexCache, so an expression is
+ * only compiled once, and copying a Regex is cheap.
+ *
  * Created by jrpotter (11/26/2015).
  */
 
@@ -21,24 +33,38 @@
 #define SAGE_REGEX_H
 
 #include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <list>
 #include <limits>
 #include <sstream>
 
 #include "macro.h"
+#include "utf8.h"
 
 #include "DFA.h"
 #include "InvalidRegex.h"
+#include "RegexCache.h"
 
 namespace sage
 {
     class Regex
     {
+        // Requires access to the NFA of an expression
+        friend class RegexSet;
+
         public:
 
+            // Flags modifying how an expression is read. These may be or'ed together.
+            enum REGEX_FLAG
+            {
+                FLAG_NONE   = 0,        // Expressions refer to bytes
+                FLAG_UTF8   = 1 << 0    // Expressions refer to UTF-8 encoded code points
+            };
+
             // Constructors
             Regex() = default;
-            Regex(std::string);
+            Regex(std::string, int = FLAG_NONE);
 
             // Other Constructors
             virtual ~Regex() = default;
@@ -48,16 +74,35 @@ namespace sage
             void swap(Regex&, Regex&);
 
             // Basic operations
-            int find(std::string);
-            bool matches(std::string, int=0);
+            int find(const std::string&) const;
+            bool matches(const std::string&, int=0) const;
 
             // Regex operations
             bool getFrontWordBounded() const;
             bool getBackWordBounded() const;
 
-            // The following enables reuse of regexes over time by saving
-            // the regexes in a map for return later on.
-            static Regex& fromPool(std::string, std::string, int = 0);
+            // Maximum number of states the automata of any Regex may consist of. Note this bounds
+            // the size of automata rather than the time taken to build them: minimizing a DFA takes
+            // time quadratic in its number of states at worst, so an expression like a{4999} is
+            // within the default limit but takes seconds to compile. Expressions taken from
+            // untrusted input are better compiled under a lower limit.
+            static void setStateLimit(unsigned long);
+
+            // Counts of the work done by Regexes (and RegexSets) of the current thread. These
+            // are always gathered, but only bumped once per construction or match.
+            struct Counters
+            {
+                unsigned long constructions;    // Expressions compiled into automata
+                unsigned long cache_hits;       // Regexes constructed from an already compiled expression
+                unsigned long cache_misses;
+                unsigned long transitions;      // DFA transitions taken while matching
+                Counters();
+                Counters operator- (const Counters&) const;
+            };
+
+            static Counters getCounters();
+            static void resetCounters();
+
 
         private:
 
@@ -66,8 +111,9 @@ namespace sage
             bool back_word_bounded;
 
             // Reference Members
+            int flags;
             std::string expr;
-            std::shared_ptr<DFA> automaton;
+            std::shared_ptr<const DFA> automaton;
 
             // Reads in a stream of characters and converts it to a corresponding NFA
             std::shared_ptr<NFA> read(std::stringstream&, int=0);
@@ -78,6 +124,22 @@ namespace sage
             // Reads in special values (those following a '\')
             std::shared_ptr<NFA> readSpecial(std::stringstream&);
 
+            // Reads in the remainder of a character beginning with the passed byte. In UTF-8 mode
+            // this is an entire code point, and otherwise just the byte itself.
+            unsigned long readCodePoint(std::stringstream&, char);
+
+            // Constructs an NFA matching any character in the given range (inclusive)
+            std::shared_ptr<NFA> buildCodePoints(unsigned long, unsigned long) const;
+
+            // Reads in counted repetitions (i.e. {m,n}) and applies them to the passed NFA
+            std::shared_ptr<NFA> readRepetition(std::stringstream&, std::shared_ptr<NFA>);
+
+            // See @setStateLimit. May be changed while other threads construct Regexes.
+            static std::atomic<unsigned long> state_limit;
+
+            // See @getCounters
+            static thread_local Counters counters;
+
             // Utility method to combine NFAs together
             const std::shared_ptr<NFA> collapseNFAs(std::list<std::shared_ptr<NFA>>&) const;
     };
@@ -0,0 +1,106 @@
+/**
+ * RegexCache.h
+ *
+ * A cache of compiled expressions, keyed by the expression and the flags it was compiled with.
+ * Compiled programs are immutable once built, and are handed out as shared pointers, so that any
+ * number of Regexes (on any number of threads) may refer to the same program. Constructing a
+ * Regex consults the process-wide cache (see @global) first, so an expression is only compiled
+ * once unless evicted in the meantime.
+ *
+ * The cache is bounded by the (approximate) number of bytes its programs occupy. Once exceeded,
+ * the least recently used programs are evicted. Note an evicted program remains alive for as long
+ * as some Regex refers to it; the cache merely forgets about it.
+ */
+
+#ifndef SAGE_REGEX_CACHE_H
+#define SAGE_REGEX_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "macro.h"
+
+#include "DFA.h"
+
+namespace sage
+{
+    class RegexCache
+    {
+        public:
+
+            // A compiled expression, along with the state limit it was compiled under (see
+            // Regex::setStateLimit). A program is only valid under limits at least as large.
+            struct Program
+            {
+                std::shared_ptr<const DFA> automaton;
+                bool front_word_bounded;
+                bool back_word_bounded;
+                unsigned long limit;
+            };
+
+            // Usage of the cache over its lifetime (save @entries and @bytes, its current contents)
+            struct Statistics
+            {
+                unsigned long hits;
+                unsigned long misses;
+                unsigned long evictions;
+                unsigned long entries;
+                unsigned long bytes;
+                Statistics();
+            };
+
+            // Constructors
+            RegexCache(unsigned long = REGEX_CACHE_BUDGET);
+            RegexCache(const RegexCache&) = delete;
+            RegexCache& operator= (const RegexCache&) = delete;
+
+            // The cache consulted by every Regex
+            static RegexCache& global();
+
+            // Returns the program compiled from the given expression and flags, valid under the
+            // given state limit, or nullptr if not present (in which case it is regarded as a miss)
+            std::shared_ptr<const Program> find(const std::string&, int, unsigned long);
+
+            // Adds a program to the cache, returning the program now cached under the given
+            // expression and flags. This differs from the passed program if another thread
+            // inserted the same expression in the meantime (unless under a larger limit, in
+            // which case the passed program, valid under more limits, takes its place).
+            std::shared_ptr<const Program> insert(const std::string&, int, std::shared_ptr<const Program>);
+
+            // Maximum number of bytes of programs to keep around (evicting as necessary)
+            void setBudget(unsigned long);
+
+            Statistics getStatistics() const;
+            void clear();
+
+        private:
+
+            using key = std::pair<std::string, int>;
+
+            // Entries are ordered from most to least recently used
+            struct Entry
+            {
+                key id;
+                std::shared_ptr<const Program> program;
+                unsigned long bytes;
+            };
+            std::list<Entry> entries;
+            std::map<key, std::list<Entry>::iterator> index;
+
+            unsigned long budget;
+            Statistics statistics;
+            mutable std::mutex mutex;
+
+            // Evicts entries until within budget. Expects @mutex to be held.
+            void evict();
+
+            // Approximate number of bytes an entry of the given expression and program occupies
+            static unsigned long size(const std::string&, const Program&);
+    };
+}
+
+#endif //SAGE_REGEX_CACHE_H
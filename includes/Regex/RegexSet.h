@@ -0,0 +1,71 @@
+/**
+ * RegexSet.h
+ *
+ * A collection of regular expressions compiled into a single automaton. Each expression
+ * is read into its own NFA whose finishing nodes are labeled by the index of the expression,
+ * and all NFAs are then joined and converted into one DFA. Traversing the DFA once over a
+ * token thus reports which expressions match a prefix of the token, as well as the length
+ * of the longest such prefix for each expression.
+ *
+ * This is used by the Parser to test every terminal of a grammar at a given position in
+ * a single pass, instead of running each terminal's Regex separately as alternatives are
+ * attempted (see Scanner::hasNext).
+ *
+ * Matching keeps its position in the automaton to itself, so once compiled a set may be
+ * matched against from many threads at once. Adding to or compiling the set may not.
+ */
+
+#ifndef SAGE_REGEX_SET_H
+#define SAGE_REGEX_SET_H
+
+#include "Regex.h"
+
+namespace sage
+{
+    class RegexSet
+    {
+        public:
+
+            // Constructors
+            RegexSet();
+
+            // Adds the expression of the passed Regex to the set, returning the index used
+            // to refer to it. Identical expressions share the same index.
+            unsigned int add(const Regex&);
+
+            // Builds the combined automaton (done lazily if not called explicitly)
+            void compile();
+
+            // Whether the combined automaton is up to date with the expressions added
+            bool isCompiled() const;
+
+            // Number of (distinct) expressions in the set
+            unsigned long size() const;
+
+            // Determines the longest match of each expression against a prefix of the passed
+            // token, placing the lengths into the passed vector (indexed by expression). A length
+            // of 0 indicates no match. The boolean indicates whether the token begins on a word
+            // boundary, which is required by expressions bounded at the front.
+            void matches(const std::string&, bool, std::vector<unsigned long>&);
+
+            // Maximal munch. Returns the length of the longest substring, beginning at the passed
+            // index, accepted by any expression (0 if none). The indices of all expressions accepting
+            // this substring are referenced by the passed pointer; these remain valid until the set is
+            // recompiled. Note word boundaries are not considered here.
+            unsigned long longest(const std::string&, unsigned long, const std::vector<unsigned int>*&);
+
+        private:
+
+            // Source expressions and their word boundaries
+            std::vector<std::string> exprs;
+            std::vector<int> flags;
+            std::vector<bool> front_word_bounded;
+            std::vector<bool> back_word_bounded;
+
+            // The labeled NFAs of each expression and the automaton joining them
+            std::vector<std::shared_ptr<NFA>> components;
+            std::shared_ptr<DFA> automaton;
+    };
+}
+
+#endif //SAGE_REGEX_SET_H
@@ -11,15 +11,15 @@ using namespace sage;
  * ================================
  *
  * Since Choices is the top-level of the definition hierarchy, it is also reponsible with performing the parsing
- * of the actual definition specification.
+ * of the actual definition specification. The passed flags are forwarded to every terminal encountered.
  */
-Choices::Choices(Scanner& definition)
+Choices::Choices(Scanner& definition, int flags)
 {
     // We must ensure there is always at least one sequence in place
     options.emplace_back(std::make_shared<Sequence>());
 
     // Used to determine if we should read in the character from input
-    Regex letter = Regex::fromPool(REGEX_POOL_LETTER, REGEX_EXPR_LETTER);
+    Regex letter(REGEX_EXPR_LETTER);
     while(definition.peek() != EOF) {
 
         // We read in the next character if it doesn't belong to a nonterminal
@@ -36,7 +36,7 @@ Choices::Choices(Scanner& definition)
             case PPARSER_TERMINAL_DELIM: {
                 std::string term = definition.readUntil(PPARSER_TERMINAL_DELIM);
                 term.pop_back(); // Remove the trailing delimiter character
-                options.back()->append(std::make_shared<Terminal>(term));
+                options.back()->append(std::make_shared<Terminal>(term, flags));
                 break;
             }
 
@@ -49,7 +49,7 @@ Choices::Choices(Scanner& definition)
             // Recursively build up the next choice.
             // This is why we must pass the scanner by reference.
             case PPARSER_SUB_START: {
-                options.back()->append(std::make_shared<Choices>(definition));
+                options.back()->append(std::make_shared<Choices>(definition, flags));
                 break;
             }
 
@@ -83,8 +83,8 @@ Choices::Choices(Scanner& definition)
  *
  * Delegates outward to pass by reference.
  */
-Choices::Choices(Scanner&& definition)
-    : Choices(definition)
+Choices::Choices(Scanner&& definition, int flags)
+    : Choices(definition, flags)
 { }
 
 /**
@@ -103,4 +103,52 @@ std::shared_ptr<AST> Choices::process(Scanner& s, const symbol_table& table)
     }
 
     return nullptr;
-}
\ No newline at end of file
+}
+
+/**
+ * Processing (Flattened)
+ * ================================
+ */
+bool Choices::processInto(Scanner& s, const symbol_table& table, std::vector<std::shared_ptr<AST>>& nodes)
+{
+    for(auto& option : options) {
+        if(option->parseInto(s, table, nodes)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Collect Terminals
+ * ================================
+ */
+void Choices::collectTerminals(std::shared_ptr<RegexSet> terminals)
+{
+    for(auto option : options) {
+        option->collectTerminals(terminals);
+    }
+}
+
+/**
+ * Identify Rules
+ * ================================
+ */
+void Choices::identifyRules(const std::map<std::string, unsigned int>& rules)
+{
+    for(auto option : options) {
+        option->identifyRules(rules);
+    }
+}
+
+/**
+ * Annotate Rules
+ * ================================
+ */
+void Choices::annotateRules(const std::map<std::string, RULE_ANNOTATION>& annotations)
+{
+    for(auto option : options) {
+        option->annotateRules(annotations);
+    }
+}
@@ -20,6 +20,33 @@ Definition::Definition()
     : repeat_operator(REPEAT_NONE)
 { }
 
+/**
+ * Collect Terminals
+ * ================================
+ *
+ * By default a definition has no terminals.
+ */
+void Definition::collectTerminals(std::shared_ptr<RegexSet>)
+{ }
+
+/**
+ * Identify Rules
+ * ================================
+ *
+ * By default a definition has no nonterminals.
+ */
+void Definition::identifyRules(const std::map<std::string, unsigned int>&)
+{ }
+
+/**
+ * Annotate Rules
+ * ================================
+ *
+ * By default a definition has no nonterminals.
+ */
+void Definition::annotateRules(const std::map<std::string, RULE_ANNOTATION>&)
+{ }
+
 /**
  * Parsing
  * ================================
@@ -29,8 +56,14 @@ Definition::Definition()
  * according to the repetition tag assigned to the given definition.
  *
  * As a reminder, an empty AST is valid. A nullptr indicates failure in parsing.
+ *
+ * Every parse (and every repetition below) counts as a step of the parse's Budget.
+ *
+ * A repetition stops once an iteration matches without consuming any input, as it would
+ * otherwise match again at the same position forever (e.g. ("x"?)*).
  */
 std::shared_ptr<AST> Definition::parse(Scanner& s, const symbol_table& table) {
+    Budget::step();
     switch (repeat_operator) {
         case REPEAT_KLEENE_STAR:
             return parseKleeneStar(s, table);
@@ -53,8 +86,14 @@ std::shared_ptr<AST> Definition::parse(Scanner& s, const symbol_table& table) {
 std::shared_ptr<AST> Definition::parseKleeneStar(Scanner& s, const symbol_table& table)
 {
     std::vector<std::shared_ptr<AST>> nodes;
+    auto mark = s.getMark();
     while(auto result = process(s, table)) {
         nodes.push_back(result);
+        Budget::step();
+        if(s.getMark() == mark) {
+            break;
+        }
+        mark = s.getMark();
     }
 
     if(nodes.empty()) {
@@ -76,8 +115,14 @@ std::shared_ptr<AST> Definition::parseKleeneStar(Scanner& s, const symbol_table&
 std::shared_ptr<AST> Definition::parseKleenePlus(Scanner& s, const symbol_table& table)
 {
     std::vector<std::shared_ptr<AST>> nodes;
+    auto mark = s.getMark();
     while(auto result = process(s, table)) {
         nodes.push_back(result);
+        Budget::step();
+        if(s.getMark() == mark) {
+            break;
+        }
+        mark = s.getMark();
     }
 
     if(nodes.empty()) {
@@ -113,4 +158,86 @@ std::shared_ptr<AST> Definition::parseForced(Scanner& s, const symbol_table& tab
 {
     auto result = process(s, table);
     return (result) ? result : nullptr;
-}
\ No newline at end of file
+}
+
+/**
+ * Parsing (Flattened)
+ * ================================
+ *
+ * Mirrors the repetitions above, except that repeated nodes are appended one after another
+ * rather than gathered into branches, and a missing optional definition appends nothing.
+ */
+bool Definition::parseInto(Scanner& s, const symbol_table& table, std::vector<std::shared_ptr<AST>>& nodes)
+{
+    Budget::step();
+    switch(repeat_operator) {
+        case REPEAT_KLEENE_STAR:
+        case REPEAT_KLEENE_PLUS: {
+            unsigned long count = 0;
+            auto mark = s.getMark();
+            while(processInto(s, table, nodes)) {
+                count++;
+                Budget::step();
+                if(s.getMark() == mark) {
+                    break;
+                }
+                mark = s.getMark();
+            }
+            return count > 0 || repeat_operator == REPEAT_KLEENE_STAR;
+        }
+        case REPEAT_OPTIONAL:
+            processInto(s, table, nodes);
+            return true;
+        case REPEAT_NONE:
+            return processInto(s, table, nodes);
+    }
+    return false;
+}
+
+/**
+ * Processing (Flattened)
+ * ================================
+ */
+bool Definition::processInto(Scanner& s, const symbol_table& table, std::vector<std::shared_ptr<AST>>& nodes)
+{
+    auto result = process(s, table);
+    if(result) {
+        append(nodes, result);
+    }
+    return result != nullptr;
+}
+
+/**
+ * Append
+ * ================================
+ */
+void Definition::append(std::vector<std::shared_ptr<AST>>& nodes, const std::shared_ptr<AST>& node)
+{
+    switch(node->getTag()) {
+        case AST::EMPTY:
+            break;
+        case AST::BRANCHES:
+            for(unsigned long i = 0; i < node->getChildCount(); i++) {
+                nodes.push_back(node->getChild(i));
+            }
+            break;
+        default:
+            nodes.push_back(node);
+            break;
+    }
+}
+
+/**
+ * Join
+ * ================================
+ */
+std::shared_ptr<AST> Definition::join(const std::vector<std::shared_ptr<AST>>& nodes, unsigned long begin)
+{
+    if(nodes.size() == begin) {
+        return std::make_shared<AST>();
+    } else if(nodes.size() == begin + 1) {
+        return nodes[begin];
+    } else {
+        return std::make_shared<AST>(std::vector<std::shared_ptr<AST>>(nodes.begin() + begin, nodes.end()));
+    }
+}
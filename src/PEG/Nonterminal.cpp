@@ -14,6 +14,8 @@ using namespace sage;
  */
 Nonterminal::Nonterminal(std::string reference)
     : reference(reference)
+    , rule(Tracer::NO_RULE)
+    , annotation(ANNOTATE_NONE)
 { }
 
 /**
@@ -21,15 +23,140 @@ Nonterminal::Nonterminal(std::string reference)
  * ================================
  *
  * Processing a nonterminal merely refers to processing the definition it references.
+ * Each nonterminal is regarded as a rule when profiling and tracing.
+ *
+ * If nodes are shared (see NodeTable), a rule attempted at the same position before
+ * is not parsed again; its earlier result is returned and skipped over instead.
  */
 std::shared_ptr<AST> Nonterminal::process(Scanner& s, const symbol_table& table)
 {
+    SAGE_PROFILE_RULE(profile, reference, s);
+    Tracer::Rule trace(rule, s);
+
+    auto mark = s.getMark();
+    if(auto entry = NodeTable::find(rule, mark)) {
+        if(entry->node) {
+            s.advanceTo(entry->end);
+            SAGE_PROFILE_SUCCEED(profile);
+            trace.succeed();
+        }
+        return entry->node;
+    }
+
+    std::shared_ptr<AST> node;
+    auto start = s.getPosition();
     auto itr = table.find(reference);
     if (itr != table.end()) {
         if(auto result = itr->second->parse(s, table)) {
-            return std::make_shared<AST>(reference, result);
+            SAGE_PROFILE_SUCCEED(profile);
+            trace.succeed();
+            node = std::make_shared<AST>(reference, result, rule, start);
+        }
+    }
+
+    NodeTable::insert(rule, mark, node, s.getMark());
+    return node;
+}
+
+/**
+ * Processing (Flattened)
+ * ================================
+ *
+ * As above, though the nodes of the referenced definition are appended to the list, and then
+ * wrapped according to the annotation of the rule. If nodes are shared, the nodes of the rule
+ * are recorded as a single node (see @join), and appended as such when found again.
+ */
+bool Nonterminal::processInto(Scanner& s, const symbol_table& table, std::vector<std::shared_ptr<AST>>& nodes)
+{
+    SAGE_PROFILE_RULE(profile, reference, s);
+    Tracer::Rule trace(rule, s);
+
+    auto mark = s.getMark();
+    if(auto entry = NodeTable::find(rule, mark)) {
+        if(entry->node) {
+            s.advanceTo(entry->end);
+            SAGE_PROFILE_SUCCEED(profile);
+            trace.succeed();
+            append(nodes, entry->node);
+        }
+        return entry->node != nullptr;
+    }
+
+    bool matched = false;
+    auto begin = nodes.size();
+    auto start = s.getPosition();
+    auto itr = table.find(reference);
+    if (itr != table.end() && itr->second->parseInto(s, table, nodes)) {
+        SAGE_PROFILE_SUCCEED(profile);
+        trace.succeed();
+        wrap(nodes, begin, start, s.getPosition());
+        matched = true;
+    }
+
+    if(NodeTable::isActive()) {
+        NodeTable::insert(rule, mark, (matched) ? join(nodes, begin) : nullptr, s.getMark());
+    }
+    return matched;
+}
+
+/**
+ * Wrap
+ * ================================
+ *
+ * The terminal of a leaf spans from the first through the last token gathered, though its
+ * text omits whatever lies between tokens (such as whitespace). A leaf gathering no tokens
+ * is an empty terminal at the position the rule ended at.
+ */
+void Nonterminal::wrap(std::vector<std::shared_ptr<AST>>& nodes, unsigned long begin, long start, long end)
+{
+    auto count = nodes.size() - begin;
+    if(annotation == ANNOTATE_INLINE || (annotation == ANNOTATE_TRANSPARENT && count == 1)) {
+        return;
+    }
+
+    std::shared_ptr<AST> child;
+    if(annotation == ANNOTATE_LEAF) {
+        std::string text;
+        long first = -1, last = -1;
+        for(auto i = begin; i < nodes.size(); i++) {
+            for(auto& node : nodes[i]->preorder()) {
+                if(node.getTag() == AST::TERMINAL) {
+                    text += node.getToken();
+                    first = (first < 0) ? node.getStart() : first;
+                    last = node.getEnd();
+                }
+            }
         }
+        if(first < 0) {
+            first = last = end;
+        }
+        child = std::make_shared<AST>(text, first, last);
+    } else {
+        child = join(nodes, begin);
     }
 
-    return nullptr;
-}
\ No newline at end of file
+    nodes.resize(begin);
+    nodes.push_back(std::make_shared<AST>(reference, child, rule, start));
+}
+
+/**
+ * Identify Rules
+ * ================================
+ *
+ * Nonterminals referring to undefined rules keep no identifier.
+ */
+void Nonterminal::identifyRules(const std::map<std::string, unsigned int>& rules)
+{
+    auto itr = rules.find(reference);
+    rule = (itr != rules.end()) ? itr->second : Tracer::NO_RULE;
+}
+
+/**
+ * Annotate Rules
+ * ================================
+ */
+void Nonterminal::annotateRules(const std::map<std::string, RULE_ANNOTATION>& annotations)
+{
+    auto itr = annotations.find(reference);
+    annotation = (itr != annotations.end()) ? itr->second : ANNOTATE_NONE;
+}
@@ -15,26 +15,44 @@ using namespace sage;
  * Processing is only successful if every element in the given sequence processes
  * correctly, and in the order in which they are tried. We flatten the tree if
  * possible.
+ *
+ * A failing element never consumes any input, so a checkpoint is only needed if an
+ * element after the first may fail. Trailing elements repeated 0 or more times never
+ * fail, so the checkpoint is released as soon as these are reached. This allows the
+ * scanner to discard input no longer reachable (e.g. the items of "Items -> Item*"
+ * already parsed), rather than holding on to it until the sequence is done.
  */
 #include <iostream>
 std::shared_ptr<AST> Sequence::process(Scanner& s, const symbol_table& table)
 {
-    auto index = s.saveCheckpoint();
+    auto commit = commitPoint();
+    unsigned long index = (commit > 1) ? s.saveCheckpoint() : 0;
     std::vector<std::shared_ptr<AST>> nodes;
 
     // Note if there exist no nodes in the order vector, I regard that as an
     // error (someone must've placed a choice operator at the very start of
     // a definition which doesn't make sense). Therefore we return nullptr
     // in this case.
-    for(auto node : order) {
-        if(auto result = node->parse(s, table)) {
+    for(unsigned long i = 0; i < order.size(); i++) {
+        if(i == commit && index > 0) {
+            s.releaseCheckpoint(index);
+            index = 0;
+        }
+        if(auto result = order[i]->parse(s, table)) {
             nodes.push_back(result);
         } else {
-            s.restoreCheckpoint(index);
+            if(index > 0) {
+                s.restoreCheckpoint(index);
+                SAGE_PROFILE_RESTORE();
+                Tracer::restore(s);
+            }
             return nullptr;
         }
     }
 
+    if(index > 0) {
+        s.releaseCheckpoint(index);
+    }
     if(nodes.empty()) {
         return nullptr;
     } else if(nodes.size() == 1) {
@@ -44,6 +62,59 @@ std::shared_ptr<AST> Sequence::process(Scanner& s, const symbol_table& table)
     }
 }
 
+/**
+ * Processing (Flattened)
+ * ================================
+ *
+ * As above, though the nodes of every element are appended to the list directly. On failure
+ * the list is truncated back to where it began.
+ */
+bool Sequence::processInto(Scanner& s, const symbol_table& table, std::vector<std::shared_ptr<AST>>& nodes)
+{
+    if(order.empty()) {
+        return false;
+    }
+
+    auto commit = commitPoint();
+    unsigned long index = (commit > 1) ? s.saveCheckpoint() : 0;
+    auto begin = nodes.size();
+
+    for(unsigned long i = 0; i < order.size(); i++) {
+        if(i == commit && index > 0) {
+            s.releaseCheckpoint(index);
+            index = 0;
+        }
+        if(!order[i]->parseInto(s, table, nodes)) {
+            if(index > 0) {
+                s.restoreCheckpoint(index);
+                SAGE_PROFILE_RESTORE();
+                Tracer::restore(s);
+            }
+            nodes.resize(begin);
+            return false;
+        }
+    }
+
+    if(index > 0) {
+        s.releaseCheckpoint(index);
+    }
+    return true;
+}
+
+/**
+ * Commit Point
+ * ================================
+ */
+unsigned long Sequence::commitPoint() const
+{
+    auto commit = order.size();
+    while(commit > 0 && (order[commit - 1]->repeat_operator == REPEAT_KLEENE_STAR
+                         || order[commit - 1]->repeat_operator == REPEAT_OPTIONAL)) {
+        commit--;
+    }
+    return commit;
+}
+
 /**
  * Appending
  * ================================
@@ -78,3 +149,36 @@ void Sequence::setLastOperator(char c)
             break;
     }
 }
+
+/**
+ * Collect Terminals
+ * ================================
+ */
+void Sequence::collectTerminals(std::shared_ptr<RegexSet> terminals)
+{
+    for(auto node : order) {
+        node->collectTerminals(terminals);
+    }
+}
+
+/**
+ * Identify Rules
+ * ================================
+ */
+void Sequence::identifyRules(const std::map<std::string, unsigned int>& rules)
+{
+    for(auto node : order) {
+        node->identifyRules(rules);
+    }
+}
+
+/**
+ * Annotate Rules
+ * ================================
+ */
+void Sequence::annotateRules(const std::map<std::string, RULE_ANNOTATION>& annotations)
+{
+    for(auto node : order) {
+        node->annotateRules(annotations);
+    }
+}
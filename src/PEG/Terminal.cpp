@@ -12,8 +12,9 @@ using namespace sage;
  * Constructor
  * ================================
  */
-Terminal::Terminal(std::string expr)
-    : expr(expr)
+Terminal::Terminal(std::string expr, int flags)
+    : expr(expr, flags)
+    , index(0)
 { }
 
 /**
@@ -22,12 +23,34 @@ Terminal::Terminal(std::string expr)
  *
  * We attempt to try and read the regex if possible. If not, then an error must have occurred.
  * Note we do not need the symbol_table; that is merely included to make the class concrete.
+ *
+ * If the terminal was collected into a set, we instead consult the scanner's cached results
+ * of the set, avoiding the exception raised on failure as well.
  */
 std::shared_ptr<AST> Terminal::process(Scanner& s, const symbol_table&)
 {
+    if(terminals) {
+        if(s.hasNext(*terminals, index)) {
+            auto start = s.getPosition();
+            return std::make_shared<AST>(s.next(*terminals, index), start);
+        }
+        return nullptr;
+    }
+
     try {
-        return std::make_shared<AST>(s.next(expr));
-    } catch(ScanException) {
+        auto start = s.getPosition();
+        return std::make_shared<AST>(s.next(expr), start);
+    } catch(ScanException&) {
         return nullptr;
     }
 }
+
+/**
+ * Collect Terminals
+ * ================================
+ */
+void Terminal::collectTerminals(std::shared_ptr<RegexSet> set)
+{
+    index = set->add(expr);
+    terminals = set;
+}
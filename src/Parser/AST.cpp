@@ -4,7 +4,12 @@
  * Created by jrpotter (12/16/2015).
  */
 
+#include <limits>
+#include <map>
+
 #include "Parser/AST.h"
+#include "Parser/ASTReader.h"
+#include "Parser/ParseOptions.h"
 
 using namespace sage;
 
@@ -15,11 +20,18 @@ using namespace sage;
  * Here I make a distinction between results returned when parsing results. In particular,
  * a nullptr indicates a failure in parsing while an empty parse tree (i.e. with an empty tag)
  * indicates that parsing was successful but required no nodes (perhaps all elements were optional).
+ *
+ * Every node counts toward the memory ceiling of the parse constructing it (see ParseOptions).
  */
 AST::AST()
     : type("")
+    , rule(Tracer::NO_RULE)
+    , start(-1)
+    , end(-1)
     , tag(EMPTY)
-{ }
+{
+    Budget::allocate(sizeof(AST));
+}
 
 /**
  * Constructor (Terminal)
@@ -29,37 +41,64 @@ AST::AST()
  * that there does not exist any clear idea of what type an AST is at this
  * level. When conducting contextual analysis, make sure to mark each needed
  * type parameter with a nonterminal.
+ *
+ * The span ends after the token, unless given an end (as when the token was gathered
+ * from several tokens, see Definition::RULE_ANNOTATION).
  */
-AST::AST(std::string token)
+AST::AST(std::string token, long start, long end)
         : type("")
+        , rule(Tracer::NO_RULE)
+        , start(start)
+        , end((start < 0) ? -1 : (end < 0) ? start + static_cast<long>(token.size()) : end)
         , tag(TERMINAL)
         , token(token)
-{ }
+{
+    Budget::allocate(sizeof(AST) + this->token.capacity());
+}
 
 /**
  * Constructor (Nonterminal)
  * ================================
  *
  * This should simply refer to another AST, but marked with a type (i.e. the name
- * of the nonterminal).
+ * of the nonterminal). The span begins where the nonterminal was attempted, even if
+ * the child covers nothing.
  */
-AST::AST(std::string type, std::shared_ptr<AST> child)
+AST::AST(std::string type, std::shared_ptr<AST> child, unsigned int rule, long start)
         : type(type)
+        , rule(rule)
+        , start(start)
+        , end((child->end < 0) ? start : child->end)
         , tag(NONTERMINAL)
         , child(child)
-{ }
+{
+    Budget::allocate(sizeof(AST) + this->type.capacity());
+}
 
 /**
  * Constructor (Branches)
  * ================================
  *
- * This should have a series of branches referring to other ASTs.
+ * This should have a series of branches referring to other ASTs. The span is that
+ * of the first through the last branch covering anything.
  */
 AST::AST(std::vector<std::shared_ptr<AST>> branches)
         : type("")
+        , rule(Tracer::NO_RULE)
+        , start(-1)
+        , end(-1)
         , tag(BRANCHES)
         , branches(branches)
-{ }
+{
+    for(auto& branch : this->branches) {
+        if(branch->start >= 0) {
+            start = (start < 0) ? branch->start : start;
+            end = branch->end;
+        }
+    }
+
+    Budget::allocate(sizeof(AST) + this->branches.capacity() * sizeof(std::shared_ptr<AST>));
+}
 
 /**
  * Destructor
@@ -74,9 +113,21 @@ AST::AST(std::vector<std::shared_ptr<AST>> branches)
  * the given union will be undefined. As a result, trying to assign the
  * member of the element will not make sense, since the operator = is actually
  * a member of a given object.
+ *
+ * Destroying a child would otherwise destroy its own children in turn, recursing once per
+ * level of the tree. Instead, descendants no one else refers to are detached first and
+ * destroyed one at a time, each having no children left by then.
  */
 AST::~AST()
 {
+    std::vector<std::shared_ptr<AST>> pending;
+    detach(pending);
+    while(!pending.empty()) {
+        auto node = std::move(pending.back());
+        pending.pop_back();
+        node->detach(pending);
+    }
+
     using namespace std;
     switch(tag) {
         case TERMINAL:
@@ -94,32 +145,324 @@ AST::~AST()
 }
 
 /**
- * Display
+ * Detach
  * ================================
-*/
-void AST::format(std::stringstream& output, int level) const
+ *
+ * Children referred to elsewhere (see ParseOptions::share_nodes) are left in place; releasing
+ * them merely drops a reference.
+ */
+void AST::detach(std::vector<std::shared_ptr<AST>>& pending)
 {
-    // No output in this case
-    if(tag == EMPTY) {
-        return;
-    } else if(tag != BRANCHES) {
-        output << "|-" << std::setfill('-') << std::setw(level * 5) << ' ';
+    if(tag == NONTERMINAL) {
+        if(child.use_count() == 1) {
+            pending.push_back(std::move(child));
+        }
+    } else if(tag == BRANCHES) {
+        for(auto& branch : branches) {
+            if(branch.use_count() == 1) {
+                pending.push_back(std::move(branch));
+            }
+        }
     }
+}
+
+/**
+ * Getters
+ * ================================
+ *
+ * Note the type and token are only valid for nonterminals and terminals respectively,
+ * as are the children for nonterminals and branches.
+ */
+AST::AST_TAG AST::getTag() const
+{
+    return tag;
+}
+
+long AST::getStart() const
+{
+    return start;
+}
+
+long AST::getEnd() const
+{
+    return end;
+}
+
+unsigned int AST::getRule() const
+{
+    return rule;
+}
 
+const std::string& AST::getType() const
+{
+    return type;
+}
+
+const std::string& AST::getToken() const
+{
+    return token;
+}
+
+unsigned long AST::getChildCount() const
+{
     switch(tag) {
-        case TERMINAL:
-            output << token << std::endl;
-            break;
         case NONTERMINAL:
-            output << type << std::endl;
-            child->format(output, level + 1);
-            break;
+            return 1;
         case BRANCHES:
-            for(auto branch : branches) {
-                branch->format(output, level + 1);
-            }
-            break;
+            return branches.size();
         default:
-            break;
+            return 0;
+    }
+}
+
+const std::shared_ptr<AST>& AST::getChild(unsigned long index) const
+{
+    return (tag == NONTERMINAL) ? child : branches[index];
+}
+
+/**
+ * Iterator Constructor
+ * ================================
+ *
+ * A postorder traversal begins at the leftmost leaf, and so descends upon construction.
+ */
+AST::Iterator::Iterator()
+    : order(PREORDER)
+{ }
+
+AST::Iterator::Iterator(const AST* root, ORDER order)
+    : order(order)
+{
+    stack.push_back({ root, 0 });
+    if(order == POSTORDER) {
+        while(descend());
+    }
+}
+
+/**
+ * Iterator Access
+ * ================================
+ */
+const AST& AST::Iterator::operator* () const
+{
+    return *stack.back().node;
+}
+
+const AST* AST::Iterator::operator-> () const
+{
+    return stack.back().node;
+}
+
+unsigned long AST::Iterator::getDepth() const
+{
+    return stack.size() - 1;
+}
+
+/**
+ * Iterator Comparison
+ * ================================
+ *
+ * Iterators are only compared against iterators of the same traversal (or its end), so
+ * comparing the current node and depth suffices.
+ */
+bool AST::Iterator::operator== (const Iterator& other) const
+{
+    if(stack.empty() || other.stack.empty()) {
+        return stack.empty() && other.stack.empty();
+    }
+    return stack.back().node == other.stack.back().node && stack.size() == other.stack.size();
+}
+
+bool AST::Iterator::operator!= (const Iterator& other) const
+{
+    return !(*this == other);
+}
+
+/**
+ * Iterator Advance
+ * ================================
+ *
+ * In preorder, the next node is the first child of the current node, or else the next
+ * sibling of the nearest node (itself included) having one. In postorder, it is the leftmost
+ * leaf beneath the next sibling of the current node, or else its parent.
+ */
+bool AST::Iterator::descend()
+{
+    auto& frame = stack.back();
+    if(frame.next < frame.node->getChildCount()) {
+        const AST* next = frame.node->getChild(frame.next++).get();
+        stack.push_back({ next, 0 });
+        return true;
+    }
+    return false;
+}
+
+AST::Iterator& AST::Iterator::operator++ ()
+{
+    if(order == PREORDER) {
+        while(!stack.empty() && !descend()) {
+            stack.pop_back();
+        }
+    } else {
+        stack.pop_back();
+        if(!stack.empty() && descend()) {
+            while(descend());
+        }
+    }
+    return *this;
+}
+
+/**
+ * Traversals
+ * ================================
+ */
+AST::Traversal AST::preorder() const
+{
+    return { Iterator(this, Iterator::PREORDER) };
+}
+
+AST::Traversal AST::postorder() const
+{
+    return { Iterator(this, Iterator::POSTORDER) };
+}
+
+/**
+ * Display
+ * ================================
+ *
+ * Each node is indented by five dashes per level (the first dash giving way to a space). The
+ * indentation is built once for the deepest level reached, and lines are gathered into a
+ * buffer written out every AST_FORMAT_BUFFER bytes rather than streamed piece by piece.
+ */
+void AST::format(std::stringstream& output, int level) const
+{
+    std::string indent("|-"), buffer;
+    for(auto it = preorder().begin(); it != Iterator(); ++it) {
+        const std::string* text;
+        switch(it->tag) {
+            case TERMINAL:
+                text = &it->token;
+                break;
+            case NONTERMINAL:
+                text = &it->type;
+                break;
+            default:
+                continue;
+        }
+
+        unsigned long width = (level + it.getDepth()) * 5;
+        if(indent.size() < width + 2) {
+            indent.append(width + 2 - indent.size(), '-');
+        }
+        buffer.append(indent, 0, (width > 0) ? width + 1 : 2);
+        buffer += ' ';
+        buffer += *text;
+        buffer += '\n';
+        if(buffer.size() >= AST_FORMAT_BUFFER) {
+            output.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
     }
-}
\ No newline at end of file
+    output.write(buffer.data(), buffer.size());
+}
+
+/**
+ * Serialize
+ * ================================
+ *
+ * Nodes are written in preorder, in a single traversal with an explicit stack. The number of
+ * bytes taken by the children of a node is only known once they have been written, so it is
+ * reserved upon entering the node and patched upon leaving it. The table of types is gathered
+ * as nonterminals are met, and written ahead of the nodes at the end.
+ *
+ * Throws InvalidAST (before writing anything) if the tree does not fit the fixed width fields
+ * of the format, i.e. if some count or size exceeds 32 bits or some rule index exceeds 16 bits.
+ */
+void AST::serialize(std::ostream& output) const
+{
+    const unsigned long limit = std::numeric_limits<std::uint32_t>::max();
+    std::string body;
+    std::vector<const AST*> types;
+    std::map<std::string, std::uint32_t> indices;
+    unsigned long nodes = 0;
+
+    // Each frame holds the node, the offset its children begin at and the next child to visit
+    struct Frame
+    {
+        const AST* node;
+        unsigned long children;
+        unsigned long next;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({ this, 0, 0 });
+
+    while(!stack.empty()) {
+        auto& frame = stack.back();
+        const AST* node = frame.node;
+
+        // First visit, so write out the node itself
+        if(frame.next == 0) {
+            nodes++;
+            bool spanned = node->start >= 0;
+            body.push_back(static_cast<char>(node->tag | (spanned ? ASTReader::FLAG_SPAN : 0)));
+
+            if(spanned) {
+                long base = (stack.size() > 1) ? stack[stack.size() - 2].node->start : 0;
+                ASTReader::writeVarint(body, ASTReader::zigzag(node->start - ((base < 0) ? 0 : base)));
+                ASTReader::writeVarint(body, static_cast<unsigned long>(node->end - node->start));
+            }
+
+            if(node->tag == TERMINAL) {
+                ASTReader::writeVarint(body, node->token.size());
+                body.append(node->token);
+            } else if(node->tag == NONTERMINAL) {
+                auto it = indices.find(node->type);
+                if(it == indices.end()) {
+                    if(node->rule > Tracer::NO_RULE || node->type.size() > limit) {
+                        throw InvalidAST("Type " + node->type + " does not fit the serialized form");
+                    }
+                    it = indices.insert(std::make_pair(node->type, types.size())).first;
+                    types.push_back(node);
+                }
+                ASTReader::writeVarint(body, it->second);
+            } else if(node->tag == BRANCHES) {
+                ASTReader::writeVarint(body, node->branches.size());
+            }
+
+            if(node->tag == NONTERMINAL || node->tag == BRANCHES) {
+                ASTReader::writeFixed(body, 0);
+                frame.children = body.size();
+            }
+        }
+
+        if(frame.next < node->getChildCount()) {
+            const AST* next = node->getChild(frame.next++).get();
+            stack.push_back({ next, 0, 0 });
+        } else {
+            if(node->tag == NONTERMINAL || node->tag == BRANCHES) {
+                if(body.size() - frame.children > limit) {
+                    throw InvalidAST("Children of a node exceed the serialized form");
+                }
+                std::string size;
+                ASTReader::writeFixed(size, body.size() - frame.children);
+                body.replace(frame.children - size.size(), size.size(), size);
+            }
+            stack.pop_back();
+        }
+    }
+
+    if(nodes > limit) {
+        throw InvalidAST("Number of nodes exceeds the serialized form");
+    }
+
+    std::string header(AST_MAGIC);
+    ASTReader::writeFixed(header, nodes);
+    ASTReader::writeFixed(header, types.size());
+    for(auto type : types) {
+        ASTReader::writeFixed(header, type->rule, sizeof(std::uint16_t));
+        ASTReader::writeFixed(header, type->type.size());
+        header.append(type->type);
+    }
+    output.write(header.data(), header.size());
+    output.write(body.data(), body.size());
+}
@@ -0,0 +1,117 @@
+/**
+ * ASTIndex.cpp
+ */
+
+#include <algorithm>
+
+#include "Parser/ASTIndex.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ *
+ * The positions of the nodes on the path to the current node are kept by depth, such that the
+ * parent of a node is the last position recorded one level above it.
+ */
+ASTIndex::ASTIndex(std::shared_ptr<AST> root)
+    : root(root)
+{
+    std::vector<unsigned long> path;
+    for(auto it = root->preorder().begin(); it != AST::Iterator(); ++it) {
+        unsigned long position = nodes.size();
+        unsigned long depth = it.getDepth();
+        path.resize(depth + 1);
+        path[depth] = position;
+        nodes.push_back({ &*it, (depth > 0) ? path[depth - 1] : NO_NODE });
+
+        if(it->getTag() == AST::NONTERMINAL && it->getRule() != Tracer::NO_RULE) {
+            if(rules.size() <= it->getRule()) {
+                rules.resize(it->getRule() + 1);
+            }
+            rules[it->getRule()].push_back(position);
+            if(rules[it->getRule()].size() == 1) {
+                types[it->getType()] = it->getRule();
+            }
+        }
+    }
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+unsigned long ASTIndex::size() const
+{
+    return nodes.size();
+}
+
+const AST& ASTIndex::getNode(unsigned long position) const
+{
+    return *nodes.at(position).node;
+}
+
+unsigned int ASTIndex::getRule(const std::string& type) const
+{
+    auto it = types.find(type);
+    return (it == types.end()) ? Tracer::NO_RULE : it->second;
+}
+
+/**
+ * Find All
+ * ================================
+ */
+const std::vector<unsigned long>& ASTIndex::findAll(unsigned int rule) const
+{
+    static const std::vector<unsigned long> none;
+    return (rule < rules.size()) ? rules[rule] : none;
+}
+
+/**
+ * Find First
+ * ================================
+ *
+ * Nonterminals of a rule begin in document order, so the search begins at the first one not
+ * beginning before the span. Those beginning there but ending past the span (e.g. a rule
+ * containing itself) are skipped, until reaching nodes beginning past the span.
+ */
+unsigned long ASTIndex::findFirst(unsigned int rule, long start, long end) const
+{
+    auto& positions = findAll(rule);
+    auto it = std::lower_bound(positions.begin(), positions.end(), start,
+        [this](unsigned long position, long offset) {
+            return nodes[position].node->getStart() < offset;
+        });
+
+    for(; it != positions.end(); ++it) {
+        const AST* node = nodes[*it].node;
+        if(node->getStart() >= end) {
+            break;
+        } else if(node->getEnd() <= end) {
+            return *it;
+        }
+    }
+
+    return NO_NODE;
+}
+
+/**
+ * Ancestors
+ * ================================
+ */
+unsigned long ASTIndex::getParent(unsigned long position) const
+{
+    return nodes.at(position).parent;
+}
+
+unsigned long ASTIndex::getAncestor(unsigned long position, unsigned int rule) const
+{
+    for(position = getParent(position); position != NO_NODE; position = nodes[position].parent) {
+        const AST* node = nodes[position].node;
+        if(node->getTag() == AST::NONTERMINAL && node->getRule() == rule) {
+            return position;
+        }
+    }
+    return NO_NODE;
+}
@@ -0,0 +1,271 @@
+/**
+ * ASTReader.cpp
+ */
+
+#include <limits>
+
+#include "Parser/ASTReader.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ *
+ * Only the header is read here; nodes are read (and validated) when visited.
+ */
+ASTReader::ASTReader(const char* data, unsigned long length)
+    : data(data)
+    , length(length)
+{
+    const unsigned long magic = sizeof(AST_MAGIC) - 1;
+    if(length < magic || std::string(data, magic) != AST_MAGIC) {
+        throw InvalidAST("Serialized tree does not begin with " AST_MAGIC);
+    }
+
+    unsigned long offset = magic;
+    nodes = readFixed(offset, length);
+    auto count = readFixed(offset, length);
+    for(std::uint32_t i = 0; i < count; i++) {
+        Type type;
+        type.rule = readFixed(offset, length, sizeof(std::uint16_t));
+        type.length = readFixed(offset, length);
+        type.name = data + offset;
+        if(type.length > length - offset) {
+            throw InvalidAST("Serialized tree is truncated");
+        }
+        offset += type.length;
+        types.push_back(type);
+    }
+
+    root = offset;
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+unsigned long ASTReader::size() const
+{
+    return nodes;
+}
+
+ASTReader::Node ASTReader::getRoot() const
+{
+    return Node(*this, root, length, -1);
+}
+
+/**
+ * Integers
+ * ================================
+ *
+ * Offsets never exceed the limits they are checked against, so bounds are checked by subtracting
+ * from the limit; lengths read from the data may be large enough to overflow any sum. Fixed width
+ * integers are assembled a byte at a time, least significant first, regardless of the host.
+ */
+void ASTReader::writeFixed(std::string& output, std::uint32_t value, unsigned long width)
+{
+    for(unsigned long i = 0; i < width; i++) {
+        output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+std::uint32_t ASTReader::readFixed(unsigned long& offset, unsigned long limit, unsigned long width) const
+{
+    if(width > limit - offset) {
+        throw InvalidAST("Serialized tree is truncated");
+    }
+    std::uint32_t value = 0;
+    for(unsigned long i = 0; i < width; i++) {
+        value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset++])) << (8 * i);
+    }
+    return value;
+}
+
+void ASTReader::writeVarint(std::string& output, unsigned long value)
+{
+    while(value >= 0x80) {
+        output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+unsigned long ASTReader::readVarint(const char* data, unsigned long length, unsigned long& offset)
+{
+    unsigned long value = 0;
+    for(unsigned int shift = 0; shift < 64; shift += 7) {
+        if(offset >= length) {
+            throw InvalidAST("Serialized tree is truncated");
+        }
+        auto byte = static_cast<unsigned char>(data[offset++]);
+        value |= static_cast<unsigned long>(byte & 0x7F) << shift;
+        if(byte < 0x80) {
+            return value;
+        }
+    }
+    throw InvalidAST("Serialized tree holds an overlong integer");
+}
+
+unsigned long ASTReader::zigzag(long value)
+{
+    return (static_cast<unsigned long>(value) << 1) ^ static_cast<unsigned long>(value >> 63);
+}
+
+long ASTReader::unzigzag(unsigned long value)
+{
+    return static_cast<long>(value >> 1) ^ -static_cast<long>(value & 1);
+}
+
+/**
+ * Node Constructor
+ * ================================
+ *
+ * Decodes the node at the given offset, which must end by @parent_end. Spans are relative
+ * to the start of the parent (or 0 if the parent covers nothing).
+ */
+ASTReader::Node::Node(const ASTReader& reader, unsigned long offset, unsigned long parent_end,
+                      long parent_start)
+    : reader(&reader)
+    , rule(Tracer::NO_RULE)
+    , start(-1)
+    , end(-1)
+    , text(nullptr)
+    , text_length(0)
+    , children(0)
+    , parent_end(parent_end)
+    , parent_start(parent_start)
+{
+    if(offset >= parent_end) {
+        throw InvalidAST("Node at " + std::to_string(offset) + " lies outside its parent");
+    }
+
+    auto flags = static_cast<std::uint8_t>(reader.data[offset++]);
+    if((flags & 0x3) > AST::BRANCHES || (flags & ~(FLAG_SPAN | 0x3)) != 0) {
+        throw InvalidAST("Node at " + std::to_string(offset - 1) + " has an unknown tag");
+    }
+    tag = static_cast<AST::AST_TAG>(flags & 0x3);
+
+    if(flags & FLAG_SPAN) {
+        const unsigned long limit = std::numeric_limits<long>::max();
+        unsigned long base = (parent_start < 0) ? 0 : parent_start;
+        long delta = unzigzag(readVarint(reader.data, parent_end, offset));
+        unsigned long width = readVarint(reader.data, parent_end, offset);
+        if((delta < 0 && static_cast<unsigned long>(-(delta + 1)) >= base)
+           || (delta > 0 && static_cast<unsigned long>(delta) > limit - base)) {
+            throw InvalidAST("Node at " + std::to_string(offset) + " has an invalid span");
+        }
+        start = static_cast<long>(base) + delta;
+        if(width > limit - static_cast<unsigned long>(start)) {
+            throw InvalidAST("Node at " + std::to_string(offset) + " has an invalid span");
+        }
+        end = start + static_cast<long>(width);
+    }
+
+    switch(tag) {
+        case AST::TERMINAL:
+            text_length = readVarint(reader.data, parent_end, offset);
+            text = reader.data + offset;
+            if(text_length > parent_end - offset) {
+                throw InvalidAST("Token at " + std::to_string(offset) + " lies outside its parent");
+            }
+            offset += text_length;
+            break;
+        case AST::NONTERMINAL: {
+            auto index = readVarint(reader.data, parent_end, offset);
+            if(index >= reader.types.size()) {
+                throw InvalidAST("Node at " + std::to_string(offset) + " refers to an unknown type");
+            }
+            rule = reader.types[index].rule;
+            text = reader.types[index].name;
+            text_length = reader.types[index].length;
+            children = 1;
+            break;
+        }
+        case AST::BRANCHES:
+            children = readVarint(reader.data, parent_end, offset);
+            break;
+        case AST::EMPTY:
+            break;
+    }
+
+    first_child = next = offset;
+    if(tag == AST::NONTERMINAL || tag == AST::BRANCHES) {
+        auto size = reader.readFixed(first_child, parent_end);
+        if(size > parent_end - first_child) {
+            throw InvalidAST("Children at " + std::to_string(first_child) + " lie outside their parent");
+        }
+        next = first_child + size;
+    }
+}
+
+/**
+ * Node Getters
+ * ================================
+ */
+AST::AST_TAG ASTReader::Node::getTag() const
+{
+    return tag;
+}
+
+unsigned int ASTReader::Node::getRule() const
+{
+    return rule;
+}
+
+long ASTReader::Node::getStart() const
+{
+    return start;
+}
+
+long ASTReader::Node::getEnd() const
+{
+    return end;
+}
+
+const char* ASTReader::Node::getText() const
+{
+    return text;
+}
+
+unsigned long ASTReader::Node::getTextLength() const
+{
+    return text_length;
+}
+
+std::string ASTReader::Node::getString() const
+{
+    return (text) ? std::string(text, text_length) : std::string();
+}
+
+unsigned long ASTReader::Node::getChildCount() const
+{
+    return children;
+}
+
+/**
+ * Node Children
+ * ================================
+ */
+ASTReader::Node ASTReader::Node::getChild(unsigned long position) const
+{
+    if(position >= children) {
+        throw InvalidAST("Child " + std::to_string(position) + " is out of range");
+    }
+
+    Node child(*reader, first_child, next, start);
+    for(unsigned long i = 0; i < position; i++) {
+        child = child.getNextSibling();
+    }
+    return child;
+}
+
+bool ASTReader::Node::hasNextSibling() const
+{
+    return next < parent_end;
+}
+
+ASTReader::Node ASTReader::Node::getNextSibling() const
+{
+    return Node(*reader, next, parent_end, parent_start);
+}
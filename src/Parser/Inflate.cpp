@@ -0,0 +1,123 @@
+/**
+ * Inflate.cpp
+ */
+
+#include <algorithm>
+
+#include "Parser/Inflate.h"
+
+#ifdef SAGE_ZLIB
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ *
+ * A window size of 15 (the maximum) plus 32 has zlib detect whether a gzip or zlib
+ * header is present. The compressed chunk holds at least the two magic bytes of a gzip
+ * member, which are examined together (see @hasMember).
+ */
+Inflate::Inflate(std::streambuf& source, unsigned long chunk_size)
+    : source(source)
+    , compressed(std::max<unsigned long>(chunk_size, 2), '\0')
+    , decompressed(std::max<unsigned long>(chunk_size, 1), '\0')
+    , finished(false)
+{
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    if(inflateInit2(&stream, 15 + 32) != Z_OK) {
+        throw InputError("Could not initialize decompression");
+    }
+}
+
+Inflate::~Inflate()
+{
+    inflateEnd(&stream);
+}
+
+/**
+ * Underflow
+ * ================================
+ *
+ * Input is read from the source until at least one byte has been decompressed. Once a
+ * gzip member ends, decompression restarts if another member follows.
+ */
+Inflate::int_type Inflate::underflow()
+{
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    auto data = reinterpret_cast<Bytef*>(&decompressed[0]);
+    stream.next_out = data;
+    stream.avail_out = static_cast<uInt>(decompressed.size());
+
+    while(!finished && stream.next_out == data) {
+        if(stream.avail_in == 0) {
+            auto count = source.sgetn(&compressed[0], static_cast<std::streamsize>(compressed.size()));
+            if(count <= 0) {
+                throw InputError("Compressed input ended unexpectedly");
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(&compressed[0]);
+            stream.avail_in = static_cast<uInt>(count);
+        }
+
+        switch(inflate(&stream, Z_NO_FLUSH)) {
+            case Z_OK:
+            case Z_BUF_ERROR:
+                break;
+            case Z_STREAM_END:
+                if(hasMember()) {
+                    inflateReset(&stream);
+                } else {
+                    finished = true;
+                }
+                break;
+            default:
+                throw InputError("Could not decompress input");
+        }
+    }
+
+    if(stream.next_out == data) {
+        return traits_type::eof();
+    }
+
+    setg(&decompressed[0], &decompressed[0], reinterpret_cast<char*>(stream.next_out));
+    return traits_type::to_int_type(*gptr());
+}
+
+/**
+ * Has Member
+ * ================================
+ *
+ * Members begin with the two bytes 0x1f 0x8b. Input left over from the last chunk is moved to
+ * the front of the buffer, so that both bytes can be examined even if split across chunks.
+ */
+bool Inflate::hasMember()
+{
+    if(stream.avail_in < 2) {
+        auto front = &compressed[0];
+        std::char_traits<char>::move(front, reinterpret_cast<char*>(stream.next_in), stream.avail_in);
+        auto count = source.sgetn(front + stream.avail_in,
+                                  static_cast<std::streamsize>(compressed.size() - stream.avail_in));
+        stream.next_in = reinterpret_cast<Bytef*>(front);
+        stream.avail_in += static_cast<uInt>((count > 0) ? count : 0);
+    }
+
+    return stream.avail_in >= 2 && stream.next_in[0] == 0x1f && stream.next_in[1] == 0x8b;
+}
+
+/**
+ * Show Many
+ * ================================
+ */
+std::streamsize Inflate::showmanyc()
+{
+    return finished ? -1 : 0;
+}
+
+#endif //SAGE_ZLIB
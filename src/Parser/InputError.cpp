@@ -0,0 +1,24 @@
+/**
+ * InputError.cpp
+ */
+
+#include "Parser/InputError.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+InputError::InputError(std::string message)
+    : response(message)
+{ }
+
+/**
+ * What
+ * ================================
+ */
+const char* InputError::what() const noexcept
+{
+    return response.c_str();
+}
@@ -0,0 +1,24 @@
+/**
+ * InvalidAST.cpp
+ */
+
+#include "Parser/InvalidAST.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+InvalidAST::InvalidAST(std::string message)
+    : response(message)
+{ }
+
+/**
+ * What
+ * ================================
+ */
+const char* InvalidAST::what() const noexcept
+{
+    return response.c_str();
+}
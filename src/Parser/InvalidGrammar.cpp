@@ -18,8 +18,8 @@ InvalidGrammar::InvalidGrammar(std::string message)
 
 InvalidGrammar::InvalidGrammar(std::string message, ScanState state)
 {
-    std::stringstream ss(message);
-    ss << " at (line: " << state.getLine() << ", column: " << state.getColumn() << ")";
+    std::stringstream ss;
+    ss << message << " at (line: " << state.getLine() << ", column: " << state.getColumn() << ")";
     response = ss.str();
 }
 
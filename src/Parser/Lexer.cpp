@@ -0,0 +1,79 @@
+/**
+ * Lexer.cpp
+ */
+
+#include "Parser/Lexer.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ *
+ * Like the Scanner, a character is regarded as a delimiter if the delimiter
+ * expression matches the character by itself. Since we only ever deal with
+ * single characters, we determine this for every character up front.
+ */
+Lexer::Lexer(std::shared_ptr<RegexSet> terminals, std::string delimiter)
+    : terminals(terminals)
+{
+    Regex d(delimiter);
+    for(int c = 0; c < 256; c++) {
+        delimiters[c] = d.matches(std::string(1, static_cast<char>(c)));
+    }
+    if(!terminals->isCompiled()) {
+        terminals->compile();
+    }
+}
+
+/**
+ * Tokenize
+ * ================================
+ */
+bool Lexer::tokenize(std::istream& input, std::string& text, std::vector<Token>& tokens)
+{
+    text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    tokens.clear();
+
+    unsigned long index = 0;
+    while(true) {
+
+        // Skip any delimiter content
+        while(index < text.size() && delimiters[static_cast<unsigned char>(text[index])]) {
+            index++;
+        }
+        if(index == text.size()) {
+            return true;
+        }
+
+        // Find the longest token
+        const std::vector<unsigned int>* accepted = nullptr;
+        unsigned long length = terminals->longest(text, index, accepted);
+        if(length == 0) {
+            return false;
+        }
+
+        // Determine the kind of the token, registering a new kind if needed
+        auto it = kind_ids.find(accepted);
+        if(it == kind_ids.end()) {
+            std::vector<bool> mask(terminals->size(), false);
+            for(auto i : *accepted) {
+                mask[i] = true;
+            }
+            kinds.push_back(mask);
+            it = kind_ids.emplace(accepted, static_cast<unsigned int>(kinds.size() - 1)).first;
+        }
+
+        tokens.push_back({ it->second, index, length });
+        index += length;
+    }
+}
+
+/**
+ * Accepts
+ * ================================
+ */
+bool Lexer::accepts(const Token& token, unsigned int index) const
+{
+    return kinds[token.kind][index];
+}
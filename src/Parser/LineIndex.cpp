@@ -0,0 +1,79 @@
+/**
+ * LineIndex.cpp
+ */
+
+#include <algorithm>
+#include <string>
+
+#include "Parser/LineIndex.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+LineIndex::LineIndex()
+    : length(0)
+    , dropped(0)
+{ }
+
+/**
+ * Append
+ * ================================
+ *
+ * Newlines are found with char_traits::find, which the standard library implements
+ * with memchr (and is thus vectorized), rather than by inspecting each byte in turn.
+ */
+void LineIndex::append(const char* content, unsigned long count)
+{
+    const char* end = content + count;
+    const char* next = content;
+    while(next < end) {
+        next = std::char_traits<char>::find(next, static_cast<std::size_t>(end - next), '\n');
+        if(next == nullptr) {
+            break;
+        }
+        newlines.push_back(length + static_cast<unsigned long>(next - content));
+        next++;
+    }
+    length += count;
+}
+
+void LineIndex::clear()
+{
+    newlines.clear();
+    length = 0;
+    dropped = 0;
+}
+
+/**
+ * Discard
+ * ================================
+ *
+ * The last newline before the offset is kept, since columns of the line it ends are still
+ * measured from it.
+ */
+void LineIndex::discard(unsigned long offset)
+{
+    auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+    if(it - newlines.begin() > 1) {
+        dropped += static_cast<unsigned long>(it - newlines.begin()) - 1;
+        newlines.erase(newlines.begin(), it - 1);
+    }
+}
+
+/**
+ * Locate
+ * ================================
+ *
+ * The line of an offset is one more than the number of newlines preceding it (including
+ * those dropped), and its column is measured from the last of these.
+ */
+ScanState LineIndex::locate(unsigned long offset) const
+{
+    auto it = std::lower_bound(newlines.begin(), newlines.end(), offset);
+    auto line = static_cast<unsigned int>(dropped + static_cast<unsigned long>(it - newlines.begin())) + 1;
+    auto start = (it == newlines.begin()) ? 0 : *(it - 1) + 1;
+    return ScanState(static_cast<long>(offset), line, static_cast<unsigned int>(offset - start + 1));
+}
@@ -0,0 +1,98 @@
+/**
+ * NodeTable.cpp
+ */
+
+#include "Parser/NodeTable.h"
+#include "Parser/ParseOptions.h"
+
+using namespace sage;
+
+thread_local NodeTable* NodeTable::active = nullptr;
+
+/**
+ * Constructor
+ * ================================
+ */
+NodeTable::NodeTable()
+    : hits(0)
+{ }
+
+/**
+ * Attachment
+ * ================================
+ */
+NodeTable::Attachment::Attachment(NodeTable* table)
+    : previous(active)
+{
+    active = table;
+}
+
+NodeTable::Attachment::~Attachment()
+{
+    active = previous;
+}
+
+/**
+ * Key
+ * ================================
+ *
+ * Rules are identified by 16 bits (see Tracer::NO_RULE), leaving the remaining bits to the mark.
+ */
+unsigned long NodeTable::key(unsigned int rule, unsigned long mark)
+{
+    return (mark << 16) | (rule & 0xFFFF);
+}
+
+/**
+ * Active
+ * ================================
+ */
+bool NodeTable::isActive()
+{
+    return active != nullptr;
+}
+
+/**
+ * Find
+ * ================================
+ */
+const NodeTable::Entry* NodeTable::find(unsigned int rule, unsigned long mark)
+{
+    if(!active) {
+        return nullptr;
+    }
+
+    auto it = active->entries.find(key(rule, mark));
+    if(it == active->entries.end()) {
+        return nullptr;
+    }
+
+    active->hits++;
+    return &it->second;
+}
+
+/**
+ * Insert
+ * ================================
+ *
+ * Entries count toward the memory ceiling of the parse, like the nodes themselves.
+ */
+void NodeTable::insert(unsigned int rule, unsigned long mark, std::shared_ptr<AST> node, unsigned long end)
+{
+    if(active) {
+        Budget::allocate(sizeof(unsigned long) + sizeof(Entry));
+        Entry entry;
+        entry.node = node;
+        entry.end = end;
+        active->entries[key(rule, mark)] = entry;
+    }
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+unsigned long NodeTable::getHits() const
+{
+    return hits;
+}
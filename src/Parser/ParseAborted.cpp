@@ -0,0 +1,55 @@
+/**
+ * ParseAborted.cpp
+ */
+
+#include "Parser/ParseAborted.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+ParseAborted::ParseAborted(ABORT_REASON reason, unsigned long steps)
+    : reason(reason)
+    , steps(steps)
+{
+    switch(reason) {
+        case ABORT_STEPS:
+            response = "Parse exceeded its step budget";
+            break;
+        case ABORT_DEADLINE:
+            response = "Parse exceeded its deadline";
+            break;
+        case ABORT_MEMORY:
+            response = "Parse exceeded its memory ceiling";
+            break;
+        case ABORT_CANCELLED:
+            response = "Parse was cancelled";
+            break;
+    }
+    response += " after " + std::to_string(steps) + " steps";
+}
+
+/**
+ * What
+ * ================================
+ */
+const char* ParseAborted::what() const noexcept
+{
+    return response.c_str();
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+ParseAborted::ABORT_REASON ParseAborted::getReason() const
+{
+    return reason;
+}
+
+unsigned long ParseAborted::getSteps() const
+{
+    return steps;
+}
@@ -0,0 +1,15 @@
+/**
+ * ParseContext.cpp
+ */
+
+#include "Parser/ParseContext.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+ParseContext::ParseContext()
+    : owner(nullptr)
+{ }
@@ -0,0 +1,105 @@
+/**
+ * ParseOptions.cpp
+ */
+
+#include <limits>
+
+#include "Parser/ParseOptions.h"
+
+using namespace sage;
+
+thread_local Budget* Budget::active = nullptr;
+
+/**
+ * Options Constructor
+ * ================================
+ */
+ParseOptions::ParseOptions()
+    : max_steps(std::numeric_limits<unsigned long>::max())
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , max_memory(std::numeric_limits<unsigned long>::max())
+    , share_nodes(false)
+    , flatten(false)
+{ }
+
+/**
+ * Timeout
+ * ================================
+ */
+ParseOptions& ParseOptions::setTimeout(std::chrono::milliseconds timeout)
+{
+    deadline = std::chrono::steady_clock::now() + timeout;
+    return *this;
+}
+
+/**
+ * Budget Constructor
+ * ================================
+ *
+ * Budgets nest, such that a parse started during another parse (on the same thread)
+ * is limited by its own options alone.
+ */
+Budget::Budget(const ParseOptions& options)
+    : previous(active)
+    , options(options)
+    , steps(0)
+    , memory(0)
+    , next_check(0)
+{
+    active = this;
+    check();
+}
+
+Budget::~Budget()
+{
+    active = previous;
+}
+
+/**
+ * Step
+ * ================================
+ *
+ * Only a single comparison is made on most steps; @next_check never exceeds the point
+ * at which the step budget runs out.
+ */
+void Budget::step()
+{
+    if(active && ++active->steps >= active->next_check) {
+        active->check();
+    }
+}
+
+/**
+ * Allocate
+ * ================================
+ */
+void Budget::allocate(unsigned long bytes)
+{
+    if(active) {
+        active->memory += bytes;
+        if(active->memory > active->options.max_memory) {
+            throw ParseAborted(ParseAborted::ABORT_MEMORY, active->steps);
+        }
+    }
+}
+
+/**
+ * Check
+ * ================================
+ */
+void Budget::check()
+{
+    if(steps > options.max_steps) {
+        throw ParseAborted(ParseAborted::ABORT_STEPS, steps);
+    } else if(options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+        throw ParseAborted(ParseAborted::ABORT_CANCELLED, steps);
+    } else if(options.deadline != std::chrono::steady_clock::time_point::max()
+              && std::chrono::steady_clock::now() >= options.deadline) {
+        throw ParseAborted(ParseAborted::ABORT_DEADLINE, steps);
+    }
+
+    next_check = steps + PARSE_CHECK_INTERVAL;
+    if(options.max_steps < next_check) {
+        next_check = options.max_steps + 1;
+    }
+}
@@ -11,9 +11,17 @@ using namespace sage;
 /**
  * Constructor
  * ================================
+ *
+ * If requested, every terminal is gathered into a single set once the grammar
+ * has been read in. Terminals then match against the set instead. Declared tokens
+ * are added first so that they are lexed in the order they were declared.
+ *
+ * Rules are then numbered (in the order of the table) for the sake of tracing, and annotated
+ * as declared.
  */
-Parser::Parser(std::string filename)
+Parser::Parser(std::string filename, int options)
     : init_stream(filename, std::ifstream::in)
+    , regex_flags((options & OPTION_UTF8) ? Regex::FLAG_UTF8 : Regex::FLAG_NONE)
 {
     if(init_stream.is_open()) {
         Scanner input(init_stream);
@@ -21,6 +29,46 @@ Parser::Parser(std::string filename)
     } else {
         throw InvalidGrammar("Invalid filename");
     }
+
+    if(!tokens.empty()) {
+        options |= OPTION_TOKEN_STREAM;
+    }
+
+    if(options & (OPTION_MULTI_PATTERN | OPTION_TOKEN_STREAM)) {
+        terminals = std::make_shared<RegexSet>();
+        for(auto token : tokens) {
+            terminals->add(Regex(token, regex_flags));
+        }
+        for(auto entry : table) {
+            entry.second->collectTerminals(terminals);
+        }
+        terminals->compile();
+    }
+
+    if(options & OPTION_TOKEN_STREAM) {
+        lexer = std::make_shared<Lexer>(terminals);
+    }
+
+    std::vector<std::string> names;
+    std::map<std::string, unsigned int> rules;
+    for(auto entry : table) {
+        rules[entry.first] = static_cast<unsigned int>(names.size());
+        names.push_back(entry.first);
+    }
+    for(auto entry : table) {
+        entry.second->identifyRules(rules);
+    }
+    start_rule = (rules.count(start)) ? rules[start] : Tracer::NO_RULE;
+    tracer.setRules(names);
+
+    for(auto& annotation : annotations) {
+        if(!table.count(annotation.first)) {
+            throw InvalidGrammar("Annotated rule " + annotation.first + " is not defined");
+        }
+    }
+    for(auto entry : table) {
+        entry.second->annotateRules(annotations);
+    }
 }
 
 /**
@@ -39,17 +87,169 @@ Parser::~Parser()
  * ================================
  *
  * Jumpstarts the parsing method by initiating parsing from the starting
- * nonterminal specified in the *.peg grammar.
+ * nonterminal specified in the *.peg grammar. In token mode the scanner
+ * lexes the input before parsing begins.
+ */
+std::shared_ptr<AST> Parser::parse(std::istream& input, const ParseOptions& options)
+{
+    Scanner wrapper = (lexer) ? Scanner(input, lexer) : Scanner(input);
+    return parse(wrapper, options);
+}
+
+/**
+ * Parsing (File)
+ * ================================
+ *
+ * Token mode gains little here, since the lexer reads in the entire file before
+ * parsing begins.
+ *
+ * Gzip files are recognized by their first two bytes, and decompressed while parsing
+ * (the compressed content is then what is read ahead).
  */
-std::shared_ptr<AST> Parser::parse(std::istream& input)
+std::shared_ptr<AST> Parser::parseFile(const std::string& filename, const ParseOptions& options)
 {
+    ReadAhead buffer(filename);
+    if(!buffer.is_open()) {
+        throw InputError("Could not open " + filename);
+    }
+
+    bool compressed = false;
+    if(buffer.sgetc() == 0x1f) {
+        buffer.sbumpc();
+        compressed = (buffer.sgetc() == 0x8b);
+        buffer.sungetc();
+    }
+
+    if(compressed) {
+#ifdef SAGE_ZLIB
+        Inflate inflated(buffer);
+        std::istream input(&inflated);
+        return parse(input, options);
+#else
+        throw InputError(filename + " is compressed, which requires building with SAGE_ZLIB");
+#endif
+    }
+
+    std::istream input(&buffer);
+    return parse(input, options);
+}
+
+/**
+ * Parsing (Context)
+ * ================================
+ *
+ * The scanner of the context is only built the first time the context is used with this
+ * parser, and is otherwise reset to read the new document.
+ */
+std::shared_ptr<AST> Parser::parse(ParseContext& context, const std::string& document, const ParseOptions& options)
+{
+    context.buffer.clear();
+    context.buffer.str(document);
+
+    if(context.scanner && context.owner == this) {
+        context.scanner->reset();
+    } else if(lexer) {
+        context.scanner.reset(new Scanner(context.buffer, lexer));
+    } else {
+        context.scanner.reset(new Scanner(context.buffer));
+    }
+    context.owner = this;
+
+    return parse(*context.scanner, options);
+}
+
+/**
+ * Parsing (Batch)
+ * ================================
+ */
+std::vector<std::shared_ptr<AST>> Parser::parseBatch(const std::vector<std::string>& documents,
+                                                     const ParseOptions& options)
+{
+    ParseContext context;
+    std::vector<std::shared_ptr<AST>> results;
+    results.reserve(documents.size());
+    for(auto& document : documents) {
+        results.push_back(parse(context, document, options));
+    }
+    return results;
+}
+
+/**
+ * Parsing (Scanner)
+ * ================================
+ *
+ * Flattened trees are built by gathering every node into a single list (see Definition::parseInto),
+ * joined into a tree once done.
+ */
+std::shared_ptr<AST> Parser::parse(Scanner& wrapper, const ParseOptions& options)
+{
+    Budget budget(options);
+    NodeTable nodes;
+    NodeTable::Attachment sharing(options.share_nodes ? &nodes : nullptr);
+    SAGE_PROFILE_ATTACH(profiler);
+    Tracer::Attachment tracing(tracer);
+    auto regex_counters = Regex::getCounters();
+
     // Begin parsing
-    Scanner wrapper(input);
-    auto result = table[start]->parse(wrapper, table);
+    // Note the starting nonterminal is profiled and traced as a rule like any other
+    std::shared_ptr<AST> result;
+    {
+        SAGE_PROFILE_RULE(profile, start, wrapper);
+        Tracer::Rule trace(start_rule, wrapper);
+        if(options.flatten) {
+            std::vector<std::shared_ptr<AST>> nodes;
+            if(table[start]->parseInto(wrapper, table, nodes)) {
+                result = Definition::join(nodes);
+            }
+        } else {
+            result = table[start]->parse(wrapper, table);
+        }
+        if(result) {
+            SAGE_PROFILE_SUCCEED(profile);
+            trace.succeed();
+        }
+    }
 
     // We must go through the entirety of the input stream for me to regard
     // the above as a successful parse. Otherwise, return failure
-    return (input.peek() == EOF) ? result : nullptr;
+    bool complete = !wrapper.hasNext();
+    counters.scanner = wrapper.getCounters();
+    counters.regex = Regex::getCounters() - regex_counters;
+    counters.shared_nodes = nodes.getHits();
+    return complete ? result : nullptr;
+}
+
+/**
+ * Profiler
+ * ================================
+ */
+Profiler& Parser::getProfiler()
+{
+    return profiler;
+}
+
+/**
+ * Tracer
+ * ================================
+ */
+Tracer& Parser::getTracer()
+{
+    return tracer;
+}
+
+/**
+ * Counters
+ * ================================
+ *
+ * Only regex work done by the thread performing the parse is included.
+ */
+Parser::Counters::Counters()
+    : shared_nodes(0)
+{ }
+
+const Parser::Counters& Parser::getCounters() const
+{
+    return counters;
 }
 
 /**
@@ -66,8 +266,8 @@ void Parser::initializeTable(Scanner& input)
     // Refer to /grammars/arithmetic.peg for a more thorough explanation
     // on the grammar. Note all other terms can be manipulated just
     // by reading in the remainder of a line or reading in words.
-    Regex arrowOperator = Regex::fromPool("pparser-arrow", "\\->");
-    Regex markedWord = Regex::fromPool("pparser-marked-word", "\\A+'?");
+    Regex arrowOperator("\\->");
+    Regex markedWord("\\A+'?");
 
     // On any given line, the first two terminals should be the nonterminal
     // being defined and the arrow operator or we've encountered a comment.
@@ -75,6 +275,8 @@ void Parser::initializeTable(Scanner& input)
 
         if(input.peek() == PPARSER_COMMENT) {
             input.readLine();
+        } else if(input.peek() == PPARSER_DIRECTIVE) {
+            readDirective(input);
         } else {
 
             // First read in nonterminal and find start if possible
@@ -92,7 +294,7 @@ void Parser::initializeTable(Scanner& input)
             input.next(arrowOperator);
 
             // Rest of line is dedicated to definition
-            table[nonterminal] = std::make_shared<Choices>(input);
+            table[nonterminal] = std::make_shared<Choices>(input, regex_flags);
         }
     }
 
@@ -102,3 +304,65 @@ void Parser::initializeTable(Scanner& input)
     }
 
 }
+
+/**
+ * Read Directive
+ * ================================
+ *
+ * Directives are statements beginning with PPARSER_DIRECTIVE, followed by the name
+ * of the directive and its arguments. The declaration of tokens takes a series of
+ * terminals, while annotations take a series of rule names.
+ */
+void Parser::readDirective(Scanner& input)
+{
+    input.read();
+    std::string directive = input.nextWord();
+    if(directive == PPARSER_DIRECTIVE_INLINE) {
+        return readAnnotation(input, Definition::ANNOTATE_INLINE);
+    } else if(directive == PPARSER_DIRECTIVE_TRANSPARENT) {
+        return readAnnotation(input, Definition::ANNOTATE_TRANSPARENT);
+    } else if(directive == PPARSER_DIRECTIVE_LEAF) {
+        return readAnnotation(input, Definition::ANNOTATE_LEAF);
+    } else if(directive != PPARSER_DIRECTIVE_TOKENS) {
+        throw InvalidGrammar("Unknown directive " + directive, input.getCurrentState());
+    }
+
+    while(input.peek() != EOF) {
+        char next = input.read();
+        if(next == PPARSER_STATEMENT_DELIM) {
+            return;
+        } else if(next == PPARSER_TERMINAL_DELIM) {
+            std::string term = input.readUntil(PPARSER_TERMINAL_DELIM);
+            term.pop_back();
+            tokens.push_back(term);
+        } else {
+            throw InvalidGrammar("Expected token declaration", input.getCurrentState());
+        }
+    }
+
+    throw InvalidGrammar("Unterminated directive", input.getCurrentState());
+}
+
+/**
+ * Read Annotation
+ * ================================
+ *
+ * A rule annotated more than once keeps the last annotation.
+ */
+void Parser::readAnnotation(Scanner& input, Definition::RULE_ANNOTATION annotation)
+{
+    while(input.peek() != EOF) {
+        if(input.peek() == PPARSER_STATEMENT_DELIM) {
+            input.read();
+            return;
+        }
+
+        try {
+            annotations[input.nextWord()] = annotation;
+        } catch(ScanException&) {
+            throw InvalidGrammar("Expected rule name", input.getCurrentState());
+        }
+    }
+
+    throw InvalidGrammar("Unterminated directive", input.getCurrentState());
+}
@@ -0,0 +1,190 @@
+/**
+ * Profiler.cpp
+ */
+
+#include "Parser/Profiler.h"
+
+using namespace sage;
+
+thread_local Profiler* Profiler::active = nullptr;
+
+/**
+ * Statistics Constructor
+ * ================================
+ */
+Profiler::Statistics::Statistics()
+    : invocations(0)
+    , successes(0)
+    , failures(0)
+    , restores(0)
+    , bytes(0)
+    , inclusive_ns(0)
+    , exclusive_ns(0)
+{ }
+
+/**
+ * Attachment
+ * ================================
+ *
+ * Attachments nest, such that a parse started during another parse (on the same
+ * thread) does not clobber the outer profiler.
+ */
+Profiler::Attachment::Attachment(Profiler& profiler)
+    : previous(active)
+{
+    active = &profiler;
+}
+
+Profiler::Attachment::~Attachment()
+{
+    active = previous;
+}
+
+/**
+ * Rule Tracking
+ * ================================
+ */
+Profiler::Rule::Rule(const std::string& rule, Scanner& scanner)
+    : scanner(scanner)
+    , success(false)
+{
+    if(active) {
+        active->enter(rule, scanner.getPosition());
+    }
+}
+
+Profiler::Rule::~Rule()
+{
+    if(active) {
+        active->exit(success, scanner.getPosition());
+    }
+}
+
+void Profiler::Rule::succeed()
+{
+    success = true;
+}
+
+/**
+ * Restore
+ * ================================
+ */
+void Profiler::restore()
+{
+    if(active && !active->frames.empty()) {
+        active->frames.back().statistics->restores++;
+    }
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+const std::map<std::string, Profiler::Statistics>& Profiler::getStatistics() const
+{
+    return statistics;
+}
+
+void Profiler::reset()
+{
+    statistics.clear();
+    stacks.clear();
+    frames.clear();
+    path.clear();
+    depths.clear();
+}
+
+/**
+ * Enter
+ * ================================
+ */
+void Profiler::enter(const std::string& rule, long position)
+{
+    auto& current = statistics[rule];
+    current.invocations++;
+    depths[&current]++;
+
+    Frame frame;
+    frame.statistics = &current;
+    frame.begin = std::chrono::steady_clock::now();
+    frame.child_ns = 0;
+    frame.position = position;
+    frame.path_length = path.size();
+    frames.push_back(frame);
+
+    if(!path.empty()) {
+        path += ';';
+    }
+    path += rule;
+}
+
+/**
+ * Exit
+ * ================================
+ *
+ * Time spent in the rule itself is the time elapsed less that spent in nested rules.
+ */
+void Profiler::exit(bool success, long position)
+{
+    Frame frame = frames.back();
+    frames.pop_back();
+
+    auto elapsed = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - frame.begin).count());
+    auto exclusive = (elapsed > frame.child_ns) ? elapsed - frame.child_ns : 0;
+
+    auto& current = *frame.statistics;
+    current.exclusive_ns += exclusive;
+    if(--depths[&current] == 0) {
+        current.inclusive_ns += elapsed;
+    }
+
+    if(success) {
+        current.successes++;
+        if(position > frame.position) {
+            current.bytes += static_cast<unsigned long>(position - frame.position);
+        }
+    } else {
+        current.failures++;
+    }
+
+    stacks[path] += exclusive;
+    path.resize(frame.path_length);
+    if(!frames.empty()) {
+        frames.back().child_ns += elapsed;
+    }
+}
+
+/**
+ * Report
+ * ================================
+ *
+ * Rules are listed by exclusive time (most expensive first). Times are in milliseconds.
+ */
+void Profiler::report(std::ostream& out) const
+{
+    std::vector<std::pair<std::string, Statistics>> sorted(statistics.begin(), statistics.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, Statistics>& a,
+                                               const std::pair<std::string, Statistics>& b) {
+        return a.second.exclusive_ns > b.second.exclusive_ns;
+    });
+
+    out << "rule\tinvocations\tsuccesses\tfailures\trestores\tbytes\tinclusive_ms\texclusive_ms\n";
+    for(auto& entry : sorted) {
+        auto& s = entry.second;
+        out << entry.first << '\t' << s.invocations << '\t' << s.successes << '\t' << s.failures << '\t'
+            << s.restores << '\t' << s.bytes << '\t' << s.inclusive_ns / 1e6 << '\t' << s.exclusive_ns / 1e6 << '\n';
+    }
+}
+
+/**
+ * Collapsed Stacks
+ * ================================
+ */
+void Profiler::collapsed(std::ostream& out) const
+{
+    std::map<std::string, unsigned long long> sorted(stacks.begin(), stacks.end());
+    for(auto& entry : sorted) {
+        out << entry.first << ' ' << entry.second << '\n';
+    }
+}
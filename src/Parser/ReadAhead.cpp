@@ -0,0 +1,126 @@
+/**
+ * ReadAhead.cpp
+ */
+
+#include "Parser/ReadAhead.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ *
+ * The worker is only started if the file could be opened, in which case the first
+ * chunk is already being read by the time the constructor returns.
+ */
+ReadAhead::ReadAhead(const std::string& filename, unsigned long chunk_size, unsigned int depth)
+    : file(filename, std::ifstream::in | std::ifstream::binary)
+    , opened(file.is_open())
+    , chunk_size(chunk_size)
+    , depth(depth)
+    , finished(false)
+    , stopping(false)
+{
+    if(opened) {
+        worker = std::thread(&ReadAhead::readChunks, this);
+    } else {
+        finished = true;
+    }
+}
+
+ReadAhead::~ReadAhead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    consumed.notify_one();
+    if(worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool ReadAhead::is_open() const
+{
+    return opened;
+}
+
+/**
+ * Read Chunks
+ * ================================
+ *
+ * Reads are made without holding the lock, such that the consumer may take chunks
+ * already read while the next is still being read.
+ */
+void ReadAhead::readChunks()
+{
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            consumed.wait(lock, [this]() { return stopping || chunks.size() < depth; });
+            if(stopping) {
+                return;
+            }
+        }
+
+        std::string chunk(chunk_size, '\0');
+        file.read(&chunk[0], static_cast<std::streamsize>(chunk_size));
+        chunk.resize(static_cast<unsigned long>(file.gcount()));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(chunk.empty()) {
+                finished = true;
+            } else {
+                chunks.push_back(std::move(chunk));
+                finished = !file;
+            }
+        }
+        produced.notify_one();
+        if(finished) {
+            return;
+        }
+    }
+}
+
+/**
+ * Underflow
+ * ================================
+ */
+ReadAhead::int_type ReadAhead::underflow()
+{
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        produced.wait(lock, [this]() { return finished || !chunks.empty(); });
+        if(chunks.empty()) {
+            return traits_type::eof();
+        }
+        current = std::move(chunks.front());
+        chunks.pop_front();
+    }
+    consumed.notify_one();
+
+    setg(&current[0], &current[0], &current[0] + current.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+/**
+ * Show Many
+ * ================================
+ *
+ * Only called once the current chunk has been consumed. Returns -1 (no more content)
+ * once the end of the file has been handed out, or 0 if the next chunk is still being
+ * read (in which case the scanner requests a single byte, waiting for the chunk).
+ */
+std::streamsize ReadAhead::showmanyc()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!chunks.empty()) {
+        return static_cast<std::streamsize>(chunks.front().size());
+    }
+    return finished ? -1 : 0;
+}
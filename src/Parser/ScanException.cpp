@@ -12,6 +12,10 @@ using namespace sage;
  * Constructor
  * ================================
  */
+ScanException::ScanException(std::string message)
+    : response(message)
+{ }
+
 ScanException::ScanException(std::string message, ScanState state)
 {
     std::stringstream ss;
@@ -13,13 +13,147 @@ using namespace sage;
  */
 Scanner::Scanner(std::istream& input, std::string delimiter)
     : input(input)
-    , states({ ScanState(input, 1, 1) })
+    , base(0)
+    , cursor(0)
+    , exhausted(false)
+    , token_cursor(0)
+    , lexed(false)
+    , match_set(nullptr)
     , delimiter(Regex(delimiter))
 {
     // Ensure our token is at the front of the stream
     clearDelimiterContent();
 }
 
+/**
+ * Constructor (Token Mode)
+ * ================================
+ *
+ * The stream is read in and lexed immediately. Our checkpoints then refer
+ * to indices of tokens instead of offsets.
+ */
+Scanner::Scanner(std::istream& input, std::shared_ptr<Lexer> lexer)
+    : input(input)
+    , base(0)
+    , cursor(0)
+    , exhausted(true)
+    , lexer(lexer)
+    , token_cursor(0)
+    , match_set(nullptr)
+{
+    lexed = lexer->tokenize(input, text, tokens);
+    lines.append(text.data(), text.size());
+    counters.bytes_read = text.size();
+}
+
+/**
+ * Reset
+ * ================================
+ *
+ * Note the checkpoints are discarded, and the match cache is cleared (as offsets
+ * may now refer to different content) but keeps its buckets.
+ */
+void Scanner::reset()
+{
+    checkpoints.clear();
+    match_cache.clear();
+    text.clear();
+    lines.clear();
+    base = 0;
+    cursor = 0;
+    token_cursor = 0;
+    counters = Counters();
+
+    if(lexer) {
+        lexed = lexer->tokenize(input, text, tokens);
+        lines.append(text.data(), text.size());
+        counters.bytes_read = text.size();
+    } else {
+        exhausted = false;
+        clearDelimiterContent();
+    }
+}
+
+/**
+ * Available
+ * ================================
+ *
+ * Content is pulled from the stream buffer directly, taking whatever it holds at the
+ * moment (up to SCANNER_CHUNK_SIZE bytes). Only if it holds nothing is a single byte
+ * requested, such that interactive streams are never waited upon for more than is needed.
+ * Note that for std::cin, this means reading a byte at a time unless synchronization
+ * with stdio is disabled (see std::ios_base::sync_with_stdio).
+ */
+bool Scanner::available(unsigned long offset)
+{
+    auto buffer = input.rdbuf();
+    while(offset >= base + text.size() && !exhausted) {
+        std::streamsize count = buffer->in_avail();
+        if(count < 0) {
+            exhausted = true;
+            break;
+        }
+
+        discard();
+        count = std::min<std::streamsize>(std::max<std::streamsize>(count, 1), SCANNER_CHUNK_SIZE);
+        auto size = text.size();
+        text.resize(size + static_cast<unsigned long>(count));
+        auto received = buffer->sgetn(&text[size], count);
+        text.resize(size + static_cast<unsigned long>(received));
+        lines.append(text.data() + size, static_cast<unsigned long>(received));
+        counters.bytes_read += static_cast<unsigned long>(received);
+        if(received < count) {
+            exhausted = true;
+        }
+    }
+    return offset < base + text.size();
+}
+
+/**
+ * Discard
+ * ================================
+ *
+ * The cursor never moves before the oldest checkpoint (checkpoints are saved in order
+ * and restoring one discards those saved after it), so content before the oldest
+ * checkpoint or the cursor is unreachable. A single byte before it is kept, in order to
+ * check word boundaries. Content is only discarded once it makes up the larger part of
+ * the buffer (and at least a chunk), so each byte is moved at most once on average.
+ */
+void Scanner::discard()
+{
+    auto keep = checkpoints.empty() ? cursor : std::min(cursor, checkpoints.front());
+    keep = (keep > 0) ? keep - 1 : 0;
+    if(keep <= base || keep - base < SCANNER_CHUNK_SIZE || keep - base < text.size() / 2) {
+        return;
+    }
+
+    counters.bytes_discarded += keep - base;
+    text.erase(0, keep - base);
+    base = keep;
+    lines.discard(base);
+
+    // Matches at discarded offsets can no longer be consulted
+    for(auto it = match_cache.begin(); it != match_cache.end(); ) {
+        if(it->first < static_cast<long>(base)) {
+            it = match_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Has Next
+ * ================================
+ */
+bool Scanner::hasNext()
+{
+    if(lexer) {
+        return !lexed || token_cursor < tokens.size();
+    }
+    return available(cursor);
+}
+
 /**
  * Next Methods
  * ================================
@@ -31,33 +165,33 @@ Scanner::Scanner(std::istream& input, std::string delimiter)
  */
 int Scanner::nextInt()
 {
-    Regex key = Regex::fromPool(REGEX_POOL_INTEGRAL, REGEX_EXPR_INTEGRAL);
+    static const Regex key(REGEX_EXPR_INTEGRAL);
     return std::stoi(next(key));
 }
 
 char Scanner::nextChar()
 {
-    Regex key = Regex::fromPool(REGEX_POOL_CHAR, REGEX_EXPR_CHAR);
+    static const Regex key(REGEX_EXPR_CHAR);
     std::string tmp = next(key);
     return tmp[0];
 }
 
 char Scanner::nextLetter()
 {
-    Regex key = Regex::fromPool(REGEX_POOL_LETTER, REGEX_EXPR_LETTER);
+    static const Regex key(REGEX_EXPR_LETTER);
     std::string tmp = next(key);
     return tmp[0];
 }
 
 double Scanner::nextDouble()
 {
-    Regex key = Regex::fromPool(REGEX_POOL_FLOAT, REGEX_EXPR_FLOAT);
+    static const Regex key(REGEX_EXPR_FLOAT);
     return std::stod(next(key));
 }
 
 std::string Scanner::nextWord()
 {
-    Regex key = Regex::fromPool(REGEX_POOL_WORD, REGEX_EXPR_WORD);
+    static const Regex key(REGEX_EXPR_WORD);
     return next(key);
 }
 
@@ -68,39 +202,106 @@ std::string Scanner::nextWord()
  * Workhorse of the scanner class that reads in characters from the input and
  * tries to match the passed regex.
  */
-std::string Scanner::next(Regex r)
+std::string Scanner::next(const Regex& r)
 {
-    // We manually keep track of the current state and revert if necessary
-    // Note the size of the columns stack will correspond to the number of lines read
-    // during this function call, while the actual values maintains the last column
-    // of the corresponding line read (or the column delta for the first line)
-    std::stack<unsigned int> columns({1});
-    std::string token = tokenize(r, columns);
+    std::string token = tokenize(r);
     std::string token_copy = token;
 
     // Work backwards through the string, testing for matches with the largest token possible
-    // We revert the state if necessary, and then save the current state to match the changes accordingly
     while(!token.empty()) {
         if(r.matches(token)) {
-            auto nl = states.top().getLine() + static_cast<unsigned int>(columns.size()) - 1;
-            auto nc = columns.top() + (columns.size() == 1) ? states.top().getColumn() : 0;
-            states.top().reset(input, nl, nc);
+            cursor += token.size();
             clearDelimiterContent();
             return token;
-        } else {
-            input.unget();
-            token.pop_back();
-            if(columns.top() == 1) {
-                columns.pop();
-            } else {
-                columns.top() -= 1;
-            }
         }
+        token.pop_back();
     }
 
     // Could not find a match, so return error
     std::string message = "Could not match token " + token_copy + " with Regex";
-    throw ScanException(message, states.top());
+    throw ScanException(message, getCurrentState());
+}
+
+/**
+ * Set Scanning
+ * ================================
+ *
+ * Equivalent to calling @next with the Regex at the given index of the set, except all
+ * expressions of the set are attempted in a single traversal of the combined automaton.
+ * Subsequent checks at the same position (e.g. when backtracking through alternatives)
+ * then merely consult the cached lengths.
+ */
+bool Scanner::hasNext(RegexSet& set, unsigned int index)
+{
+    if(lexer) {
+        return token_cursor < tokens.size() && lexer->accepts(tokens[token_cursor], index);
+    }
+    return matchAll(set)[index] > 0;
+}
+
+std::string Scanner::next(RegexSet& set, unsigned int index)
+{
+    if(lexer) {
+        if(!hasNext(set, index)) {
+            throw ScanException("Could not match token with RegexSet", getCurrentState());
+        }
+        auto& token = tokens[token_cursor++];
+        return text.substr(token.offset, token.length);
+    }
+
+    auto length = matchAll(set)[index];
+    if(length == 0) {
+        throw ScanException("Could not match token with RegexSet", getCurrentState());
+    }
+
+    std::string token = text.substr(cursor - base, length);
+    cursor += length;
+    clearDelimiterContent();
+    return token;
+}
+
+/**
+ * Match All
+ * ================================
+ *
+ * Determines the delimited token at the current offset (as done by @tokenize) and
+ * matches the set against it. The cache is discarded whenever a different set is passed.
+ */
+const std::vector<unsigned long>& Scanner::matchAll(RegexSet& set)
+{
+    if(match_set != &set) {
+        match_cache.clear();
+        match_set = &set;
+    }
+
+    long position = static_cast<long>(cursor);
+    auto it = match_cache.find(position);
+    if(it != match_cache.end()) {
+        return it->second;
+    }
+
+    // Nothing left to read
+    Budget::allocate(sizeof(position) + set.size() * sizeof(unsigned long));
+    auto& lengths = match_cache[position];
+    if(!available(cursor)) {
+        set.matches(std::string(), true, lengths);
+        return lengths;
+    }
+
+    // Determine whether we are currently along a word boundary
+    bool bounded = true;
+    if(cursor > 0) {
+        static const Regex whitespace(REGEX_EXPR_WHITESPACE);
+        bounded = whitespace.matches(std::string(1, text[cursor - 1 - base]));
+    }
+
+    auto end = cursor;
+    while(available(end) && !delimiter.matches(std::string(1, text[end - base]))) {
+        end++;
+    }
+
+    set.matches(text.substr(cursor - base, end - cursor), bounded, lengths);
+    return lengths;
 }
 
 /**
@@ -108,20 +309,20 @@ std::string Scanner::next(Regex r)
  * ================================
  * Reads in as much of the regex as possible by considering delimited regions.
  * In particular, we break up the input into tokens and then expand upon the
- * token for a proper match.
+ * token for a proper match. Note nothing is consumed; @next advances past the
+ * portion of the token actually matched.
  *
- * Note we manually check for word boundaries since we are managing a stream
- * and regex verifications are only functional in the contexts of strings.
+ * Note we manually check for word boundaries since regex verifications are only
+ * functional in the contexts of strings.
  */
-std::string Scanner::tokenize(Regex& r, std::stack<unsigned int>& columns)
+std::string Scanner::tokenize(const Regex& r)
 {
     // If the regex is aligned to match along a word boundary at the front, we should
     // immediately check if we are along a boundary and continue only if this is the case
-    if(r.getFrontWordBounded() && input.tellg() > 0) {
-        input.unget();
-        Regex whitespace = Regex::fromPool(REGEX_POOL_WHITESPACE, REGEX_EXPR_WHITESPACE);
-        if(!whitespace.matches(std::string(1, static_cast<char>(input.get())))) {
-            throw ScanException("Could not align along word boundary", states.top());
+    if(r.getFrontWordBounded() && cursor > 0) {
+        static const Regex whitespace(REGEX_EXPR_WHITESPACE);
+        if(!whitespace.matches(std::string(1, text[cursor - 1 - base]))) {
+            throw ScanException("Could not align along word boundary", getCurrentState());
         }
     }
 
@@ -129,20 +330,16 @@ std::string Scanner::tokenize(Regex& r, std::stack<unsigned int>& columns)
     // This is necessary to avoid problems regarding the above comment before the function
     // signature. That is, we read until we encounter our delimiter and then verify the
     // token we just read in matches (at least in part) with the passed Regex.
-    std::string token;
-    while(input.peek() != EOF && !delimiter.matches(std::string(1, (char) input.peek()))) {
-        token += input.get();
-        if(token.back() == '\n') {
-            columns.push(1);
-        } else {
-            columns.top() += 1;
-        }
+    auto end = cursor;
+    while(available(end) && !delimiter.matches(std::string(1, text[end - base]))) {
+        end++;
     }
+    std::string token = text.substr(cursor - base, end - cursor);
 
     // If we expect an alignment along the back of the string, we simply check if a match occurs
     // since the scanner naturally delimits via word boundaries (i.e. whitespace)
     if(r.getBackWordBounded() && !r.matches(token)) {
-        throw ScanException("Could not align along word boundary", states.top());
+        throw ScanException("Could not align along word boundary", getCurrentState());
     }
 
     return token;
@@ -157,12 +354,17 @@ std::string Scanner::tokenize(Regex& r, std::stack<unsigned int>& columns)
  */
 std::string Scanner::readLine()
 {
-    std::string buffer;
-    if(!std::getline(input, buffer)) {
-        throw ScanException("Could not extract line", states.top());
+    if(!available(cursor)) {
+        throw ScanException("Could not extract line", getCurrentState());
+    }
+
+    auto end = cursor;
+    while(available(end) && text[end - base] != '\n') {
+        end++;
     }
 
-    states.top().advance('\n');
+    std::string buffer = text.substr(cursor - base, end - cursor);
+    cursor = available(end) ? end + 1 : end;
     buffer = rtrim(buffer);
     clearDelimiterContent();
     return buffer;
@@ -180,19 +382,16 @@ std::string Scanner::readUntil(char delim)
 {
     // Build up buffer until end
     std::string buffer;
-    while(input.peek() != EOF && input.peek() != delim) {
-        buffer += input.get();
-        states.top().advance(buffer.back());
-        if(buffer.back() == '\\' && input.peek() == delim) {
-            buffer.back() = (char) input.get();
-            states.top().advance(buffer.back());
+    while(available(cursor) && text[cursor - base] != delim) {
+        buffer += text[cursor++ - base];
+        if(buffer.back() == '\\' && available(cursor) && text[cursor - base] == delim) {
+            buffer.back() = text[cursor++ - base];
         }
     }
 
     // Read in delimiter
-    if(input.peek() != EOF) {
-        buffer += input.get();
-        states.top().advance(buffer.back());
+    if(available(cursor)) {
+        buffer += text[cursor++ - base];
     }
 
     clearDelimiterContent();
@@ -203,73 +402,130 @@ std::string Scanner::readUntil(char delim)
  * Read
  * ================================
  *
- * Checks if a character exists in the remainder of the stream.
- * And reads in this character if this is the case.
+ * Reads in the next character, throwing if the end of the input has been reached.
  */
 char Scanner::read()
 {
-    char buffer[1];
-    input.read(buffer, 1);
-    states.top().advance(buffer[0]);
+    if(!available(cursor)) {
+        throw ScanException("Could not read character", getCurrentState());
+    }
+
+    char c = text[cursor++ - base];
     clearDelimiterContent();
-    return buffer[0];
+    return c;
 }
 
 /**
  * Peek
  * ================================
  *
- * Checks if a character exists in the remainder of the stream.
- * This will seek to the desired location and then look for a
- * character not corresponding to the delimiter, unless @force
- * is set to true.
- *
- * Returns EOF if no character is found.
+ * Returns the character at the given distance from the current offset without
+ * consuming anything, or EOF if no character is found (or it has been discarded). Note the result is not
+ * narrowed to a char, so that a byte of 0xFF is not confused with EOF.
  */
-char Scanner::peek(int pos)
+int Scanner::peek(int pos)
 {
-    long current = input.tellg();
-    input.seekg(current + pos);
-    char tmp = (char) input.peek();
-    input.seekg(current);
-    return tmp;
+    long offset = static_cast<long>(cursor) + pos;
+    if(offset < static_cast<long>(base) || !available(static_cast<unsigned long>(offset))) {
+        return EOF;
+    }
+    return static_cast<unsigned char>(text[static_cast<unsigned long>(offset) - base]);
 }
 
 /**
  * Checkpoint Methods
  * ================================
  *
- * Allows tracking/restoring of stream states.
+ * A checkpoint is merely the offset (or token index) to return to. Sequences release
+ * their checkpoint once they succeed, so the number of checkpoints never exceeds the
+ * nesting depth of the grammar.
  */
 unsigned long Scanner::saveCheckpoint()
 {
-    states.top().reset(input);
-    auto line = states.top().getLine();
-    auto column = states.top().getColumn();
-    states.push(ScanState(input, line, column));
-    return states.size() - 1;
+    counters.saves++;
+    checkpoints.push_back(lexer ? token_cursor : cursor);
+    return checkpoints.size();
 }
 
-ScanState Scanner::getCurrentState() const
+void Scanner::restoreCheckpoint(unsigned long index)
+{
+    index = (index < 1) ? checkpoints.size() : index;
+    counters.restores++;
+    if(lexer) {
+        token_cursor = checkpoints[index - 1];
+    } else {
+        cursor = checkpoints[index - 1];
+    }
+    checkpoints.resize(index - 1);
+}
+
+void Scanner::releaseCheckpoint(unsigned long index)
+{
+    index = (index < 1) ? checkpoints.size() : index;
+    checkpoints.resize(index - 1);
+}
+
+/**
+ * Position
+ * ================================
+ *
+ * In token mode this is the offset of the next token.
+ */
+long Scanner::getPosition() const
 {
-    return states.top();
+    if(lexer) {
+        return (token_cursor < tokens.size()) ? static_cast<long>(tokens[token_cursor].offset)
+                                              : static_cast<long>(text.size());
+    }
+    return static_cast<long>(cursor);
 }
 
-std::stack<ScanState> Scanner::restoreCheckpoint(unsigned long index)
+/**
+ * Marks
+ * ================================
+ */
+unsigned long Scanner::getMark() const
 {
-    std::stack<ScanState> result;
-    index = (index < 1) ? states.size() - 1 : index;
+    return lexer ? token_cursor : cursor;
+}
 
-    // Pop until we hit the frame indexed by @index
-    while(states.size() > index) {
-        result.push(states.top());
-        states.pop();
+void Scanner::advanceTo(unsigned long mark)
+{
+    if(lexer) {
+        token_cursor = mark;
+    } else {
+        cursor = mark;
     }
+}
 
-    // Reset state and return
-    input.clear(states.top().getBufferState());
-    input.seekg(states.top().getCursor());
-    return result;
+/**
+ * Current State
+ * ================================
+ */
+ScanState Scanner::getCurrentState() const
+{
+    return lines.locate(static_cast<unsigned long>(getPosition()));
+}
+
+/**
+ * Counters
+ * ================================
+ */
+Scanner::Counters::Counters()
+    : bytes_read(0)
+    , bytes_discarded(0)
+    , saves(0)
+    , restores(0)
+{ }
+
+const Scanner::Counters& Scanner::getCounters() const
+{
+    return counters;
+}
+
+void Scanner::resetCounters()
+{
+    counters = Counters();
 }
 
 /**
@@ -277,14 +533,13 @@ std::stack<ScanState> Scanner::restoreCheckpoint(unsigned long index)
  * ================================
  *
  * Convenience method to remove any delimiter content (such as whitespace)
- * between tokens in the specified stream. This is necessary to ensure
- * that the end of the stream has been reached at times.
+ * between tokens in the input. This is necessary to ensure that the end
+ * of the input has been reached at times.
  */
 void Scanner::clearDelimiterContent()
 {
     std::string separator;
-    while(input.peek() != EOF && delimiter.matches(separator + (char) input.peek())) {
-        separator += input.get();
-        states.top().advance(separator.back());
+    while(available(cursor) && delimiter.matches(separator + text[cursor - base])) {
+        separator += text[cursor++ - base];
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,262 @@
+/**
+ * Tracer.cpp
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Parser/Tracer.h"
+
+using namespace sage;
+
+const std::uint16_t Tracer::NO_RULE;
+thread_local Tracer* Tracer::active = nullptr;
+std::atomic<Tracer*> Tracer::signalled(nullptr);
+
+/**
+ * Constructor
+ * ================================
+ */
+Tracer::Tracer()
+    : mask(0)
+    , head(0)
+    , parse_begin(0)
+    , timeout(0)
+    , timed_out(false)
+{
+    setRules(std::vector<std::string>());
+}
+
+/**
+ * Destructor
+ * ================================
+ */
+Tracer::~Tracer()
+{
+    Tracer* expected = this;
+    signalled.compare_exchange_strong(expected, nullptr);
+}
+
+/**
+ * Attachment
+ * ================================
+ *
+ * Attaching marks the beginning of a parse as far as timeouts are concerned.
+ */
+Tracer::Attachment::Attachment(Tracer& tracer)
+    : previous(active)
+{
+    active = tracer.isEnabled() ? &tracer : nullptr;
+    if(active) {
+        active->rules.clear();
+        active->timed_out = false;
+        active->parse_begin = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - active->epoch).count());
+    }
+}
+
+Tracer::Attachment::~Attachment()
+{
+    active = previous;
+}
+
+/**
+ * Rule Tracking
+ * ================================
+ */
+Tracer::Rule::Rule(unsigned int rule, Scanner& scanner)
+    : tracer(active)
+    , scanner(scanner)
+    , success(false)
+{
+    if(tracer) {
+        auto id = static_cast<std::uint16_t>(rule < NO_RULE ? rule : NO_RULE);
+        tracer->record(id, scanner.getPosition(), EVENT_ENTER);
+        tracer->rules.push_back(id);
+    }
+}
+
+Tracer::Rule::~Rule()
+{
+    if(tracer) {
+        auto id = tracer->rules.back();
+        tracer->rules.pop_back();
+        tracer->record(id, scanner.getPosition(), success ? EVENT_SUCCEED : EVENT_FAIL);
+    }
+}
+
+void Tracer::Rule::succeed()
+{
+    success = true;
+}
+
+/**
+ * Enabling
+ * ================================
+ *
+ * The capacity is rounded up to a power of two so slots can be found by masking.
+ */
+void Tracer::enable(unsigned long capacity)
+{
+    unsigned long size = 1;
+    while(size < capacity) {
+        size <<= 1;
+    }
+
+    events.reset(new Event[size]());
+    mask = size - 1;
+    head.store(0);
+    epoch = std::chrono::steady_clock::now();
+}
+
+void Tracer::disable()
+{
+    events.reset();
+    mask = 0;
+    head.store(0);
+}
+
+bool Tracer::isEnabled() const
+{
+    return static_cast<bool>(events);
+}
+
+/**
+ * Rules
+ * ================================
+ *
+ * Names longer than a 16-bit length allows are truncated.
+ */
+void Tracer::setRules(const std::vector<std::string>& names)
+{
+    header = TRACER_MAGIC;
+    auto count = static_cast<std::uint32_t>(names.size());
+    header.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for(auto& name : names) {
+        auto length = static_cast<std::uint16_t>(std::min<unsigned long>(name.size(), 0xFFFF));
+        header.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        header.append(name, 0, length);
+    }
+}
+
+/**
+ * Restore
+ * ================================
+ */
+void Tracer::restore(Scanner& scanner)
+{
+    if(active) {
+        auto id = active->rules.empty() ? NO_RULE : active->rules.back();
+        active->record(id, scanner.getPosition(), EVENT_RESTORE);
+    }
+}
+
+/**
+ * Record
+ * ================================
+ *
+ * The event is written before @head is advanced, so a dump from another thread never
+ * sees a slot that has not yet been written (though it may see the oldest slots being
+ * overwritten while dumping).
+ */
+void Tracer::record(std::uint16_t rule, long offset, TRACE_EVENT type)
+{
+    auto timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count());
+
+    auto index = head.load(std::memory_order_relaxed);
+    Event& event = events[index & mask];
+    event.timestamp = timestamp;
+    event.offset = static_cast<std::uint32_t>(offset < 0 ? 0 : offset);
+    event.rule = rule;
+    event.type = static_cast<std::uint8_t>(type);
+    head.store(index + 1, std::memory_order_release);
+
+    if(timeout && !timed_out && timestamp - parse_begin > timeout) {
+        timed_out = true;
+        dump(timeout_path.c_str());
+    }
+}
+
+/**
+ * Dumping
+ * ================================
+ *
+ * Only system calls are used, so that dumping is safe from within a signal handler.
+ * The buffer wraps around, so the oldest events are written first, followed by the
+ * newest events from the start of the buffer.
+ */
+namespace
+{
+    bool writeAll(int fd, const void* data, unsigned long size)
+    {
+        auto bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            auto written = ::write(fd, bytes, size);
+            if(written < 0) {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<unsigned long>(written);
+        }
+        return true;
+    }
+}
+
+bool Tracer::dump(int fd) const
+{
+    auto end = head.load(std::memory_order_acquire);
+    auto capacity = events ? mask + 1 : 0;
+    auto count = static_cast<std::uint64_t>(end < capacity ? end : capacity);
+
+    if(!writeAll(fd, header.data(), header.size()) || !writeAll(fd, &count, sizeof(count))) {
+        return false;
+    }
+    if(count == 0) {
+        return true;
+    }
+
+    auto first = (end - count) & mask;
+    auto tail = std::min<unsigned long>(count, capacity - first);
+    return writeAll(fd, &events[first], tail * sizeof(Event))
+        && writeAll(fd, &events[0], (count - tail) * sizeof(Event));
+}
+
+bool Tracer::dump(const char* path) const
+{
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        return false;
+    }
+
+    bool result = dump(fd);
+    return (::close(fd) == 0) && result;
+}
+
+/**
+ * Dump Triggers
+ * ================================
+ *
+ * A zero timeout disables dumping on timeout.
+ */
+void Tracer::dumpOnTimeout(std::chrono::milliseconds limit, const std::string& path)
+{
+    timeout = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(limit).count());
+    timeout_path = path;
+}
+
+void Tracer::dumpOnSignal(int signum, const std::string& path)
+{
+    signal_path = path;
+    signalled.store(this);
+    std::signal(signum, handleSignal);
+}
+
+void Tracer::handleSignal(int)
+{
+    if(Tracer* tracer = signalled.load()) {
+        tracer->dump(tracer->signal_path.c_str());
+    }
+}
@@ -17,30 +17,13 @@ Automaton::Node::Node(bool finish)
 { }
 
 /**
- * Epsilon Closure.
+ * Node Freezing
  * ================================
- *
- * Finds the pointer in question and begins building the closure via
- * a modified form of DFA (in which only epsilon edges are traversed).
  */
-const weak_set<Automaton::Node> Automaton::Node::epsilonClosure() const
-{
-    // We are guaranteed the first element refers to the current node
-    weak_set<Node> closure;
-    epsilonClosure(epsilon[0], closure);
-    return closure;
-}
-
-void Automaton::Node::epsilonClosure(std::weak_ptr<Node> n, weak_set<Node>& closure) const
+void Automaton::Node::freeze()
 {
-    if(closure.find(n) == closure.end()) {
-        closure.insert(n);
-        if(auto current = n.lock()) {
-            for(auto next : current->epsilon) {
-                epsilonClosure(next, closure);
-            }
-        }
-    }
+    frozen = edges.freeze();
+    edges = IntervalTree<unsigned char, node_id>();
 }
 
 /**
@@ -48,7 +31,7 @@ void Automaton::Node::epsilonClosure(std::weak_ptr<Node> n, weak_set<Node>& clos
  * ================================
  *
  * All automatons must have a starting state. This is added to the
- * entire state (note only a weak pointer is maintained).
+ * entire state.
  */
 Automaton::Automaton()
 {
@@ -64,52 +47,6 @@ Automaton::Automaton()
 Automaton::~Automaton()
 { }
 
-/**
- * Automaton Copy Constructor
- * ================================
- *
- * The following goes through and creates a new node for every other node,
- * then maps all the edges correctly.
- */
-Automaton::Automaton(const Automaton& other)
-{
-    std::map<std::shared_ptr<Node>, std::shared_ptr<Node>> mapping;
-
-    // First construct the necessary nodes
-    graph.reserve(other.graph.size());
-    for(auto node : other.graph) {
-        graph.emplace_back(std::make_shared<Node>(node->finish));
-        mapping[node] = graph.back();
-    }
-
-    // Next connect the necessary nodes
-    for(auto node : other.graph) {
-        auto c_node = mapping.find(node)->second;
-
-        // Epsilon Edges
-        for(auto e_edge : node->epsilon) {
-            if(auto adj = e_edge.lock()) {
-                auto target = mapping.find(adj)->second;
-                c_node->epsilon.push_back(target);
-            }
-        }
-
-        // Other Edges
-        for(auto itr = node->edges.begin(); itr != node->edges.end(); itr++) {
-            if(auto adj = itr->lock()) {
-                auto bounds = itr.bounds();
-                auto target = mapping.find(adj)->second;
-                c_node->edges.insert(bounds.first, bounds.second, target);
-            }
-        }
-    }
-
-    // Connect our starting node
-    if(auto s_ptr = other.start.lock()) {
-        start = mapping.find(s_ptr)->second;
-    }
-}
-
 /**
  * Automaton Move Constructor
  * ================================
@@ -131,23 +68,57 @@ void Automaton::swap(Automaton& a, Automaton& b)
     swap(a.start, b.start);
 }
 
+/**
+ * Automaton Size
+ * ================================
+ */
+unsigned long Automaton::size() const
+{
+    return graph.size();
+}
+
 /**
  * Automaton Node Building
  * ================================
  *
- * Must always maintain a list of all nodes but without allowing
- * cyclic shared references amongst the nodes. A vector of all the
- * nodes and weak pointer references amongst the nodes was the settled
- * compromise.
+ * Note the returned index remains valid as more nodes are built, though
+ * references into @graph do not.
+ */
+Automaton::node_id Automaton::buildNode(bool finish)
+{
+    graph.emplace_back(finish);
+    return static_cast<node_id>(graph.size() - 1);
+}
+
+/**
+ * Automaton Absorption
+ * ================================
  *
- * Note also that the epsilon closure of every node includes the element itself.
- * The passed @next reference is a weak pointer to the current node in question.
+ * Every index within the copied nodes is shifted by the size of our graph
+ * prior to copying. The edges must be rebuilt to do so.
  */
-std::weak_ptr<Automaton::Node> Automaton::buildNode(bool finish)
+Automaton::node_id Automaton::absorb(const Automaton& other)
 {
-    std::shared_ptr<Node> next = std::make_shared<Node>(finish);
-    std::weak_ptr<Node> w_next = std::weak_ptr<Node>(next);
-    next->epsilon.push_back(w_next);
-    graph.push_back(next);
-    return w_next;
-}
\ No newline at end of file
+    auto offset = static_cast<node_id>(graph.size());
+    graph.reserve(graph.size() + other.graph.size());
+
+    for(auto& node : other.graph) {
+        graph.emplace_back(node.finish);
+        auto& copy = graph.back();
+        copy.accepts = node.accepts;
+
+        // Epsilon Edges
+        copy.epsilon.reserve(node.epsilon.size());
+        for(auto e_edge : node.epsilon) {
+            copy.epsilon.push_back(e_edge + offset);
+        }
+
+        // Other Edges
+        for(auto itr = node.edges.begin(); itr != node.edges.end(); itr++) {
+            auto bounds = itr.bounds();
+            copy.edges.insert(bounds.first, bounds.second, *itr + offset);
+        }
+    }
+
+    return offset;
+}
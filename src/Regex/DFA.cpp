@@ -12,89 +12,122 @@ using namespace sage;
  * Constructor
  * ================================
  *
- * This requires breaking up the NFA into powersets based on each
- * node's epsilon closure. Each closure represents a node in the DFA,
- * where each edge of each subnode is then an edge in the current
- * DFA.
+ * This is the powerset (subset) construction. Each DFA node corresponds to the
+ * epsilon closure of a set of NFA nodes, beginning with the closure of the NFA's
+ * starting node. For every such set, the edges of all its members are split into
+ * disjoint ranges so that each range leads to exactly one (closed) set of NFA
+ * nodes, and thus exactly one DFA node.
+ *
+ * Nodes are built in the order they are discovered, so the nodes still requiring
+ * processing are exactly those following the current one. Once minimized, the edges
+ * of every node are frozen since the DFA will no longer change.
  */
-DFA::DFA(std::shared_ptr<NFA> automaton)
-{
-    // The strong components of our graph, where we define a
-    // strong component to be the epsilon closure of the graph
-    DisjointSet<std::shared_ptr<Node>> s_components;
-
-    // The following is a mapping between the representative of
-    // each epsilon closure and the epsilon closure itself
-    std::map<std::shared_ptr<Node>, long> indices;
-    std::map<std::shared_ptr<Node>, weak_set<Node>> powersets;
-
-    // We group all nodes belonging to the same set together
-    // by finding the epsilon closure of the node. The closure
-    // belongs to the same disjoint set.
-    for(auto node : automaton->graph) {
-
-        // Attempt to create new closure. Only necessary if element
-        // not encountered before.
-        auto repr = s_components.findSet(node);
-        if(repr == s_components.end()) {
-
-            // Group epsilon closure together. Note multiple epsilon edges may exist
-            // towards a given point so we check for existence in each of these
-            s_components.createSet(node);
-            auto e_closure = node->epsilonClosure();
-            for(auto component : e_closure) {
-                auto c = component.lock();
-                if(c && s_components.findSet(c) == s_components.end()) {
-                    s_components.createSet(c);
-                    s_components.join(c, node);
-                }
-            }
+DFA::DFA(std::shared_ptr<NFA> automaton, unsigned long limit)
+{
+    const node_id none = std::numeric_limits<node_id>::max();
+
+    // The following is a mapping between each encountered set of NFA
+    // nodes and the DFA node representing it, alongside the set each
+    // DFA node represents (released once the node is processed)
+    std::map<powerset, node_id> nodes;
+    std::vector<powerset> sets;
+
+    // Reused for every closure computed below
+    SparseSet<node_id> closure(static_cast<node_id>(automaton->graph.size()));
+
+    // Our starting node was already built by the Automaton constructor
+    closure.insert(automaton->start);
+    epsilonClosure(*automaton, closure);
+    sets.emplace_back(closure.begin(), closure.end());
+    std::sort(sets.back().begin(), sets.back().end());
+    nodes[sets.back()] = start;
 
-            // Lastly pair representatives together
-            auto parent = *s_components.findSet(node);
-            powersets[parent] = e_closure;
-            indices[parent] = indices.size();
+    for(node_id current = 0; current < sets.size(); current++) {
+        powerset ps;
+        ps.swap(sets[current]);
 
+        // Mark node as finishing if any member is, and gather the labels
+        // and edges of all members for processing below
+        std::vector<unsigned int> labels;
+        std::vector<transition> moves;
+        for(auto n_id : ps) {
+            auto& n_node = automaton->graph[n_id];
+            graph[current].finish = graph[current].finish || n_node.finish;
+            labels.insert(labels.end(), n_node.accepts.begin(), n_node.accepts.end());
+            for(auto it = n_node.edges.begin(); it != n_node.edges.end(); it++) {
+                moves.emplace_back(it.bounds().first, it.bounds().second, *it);
+            }
         }
-    }
+        std::sort(labels.begin(), labels.end());
+        labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+        graph[current].accepts.swap(labels);
 
-    // We now have a vector containing our desired powersets
-    // We build corresponding DFA nodes for each
-    graph.reserve(powersets.size());
-    for(int i = 0; i < powersets.size(); i++) {
-        buildNode(false);
-    }
+        // Break up overlapping edges into disjoint ranges. Every endpoint of a range
+        // (or the character just past it) marks the beginning of a new range.
+        // Note we work with ints to avoid overflowing past the last character.
+        std::vector<int> cuts;
+        for(auto move : moves) {
+            cuts.push_back(std::get<0>(move));
+            cuts.push_back(std::get<1>(move) + 1);
+        }
+        std::sort(cuts.begin(), cuts.end());
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
 
-    // Lastly we link all nodes together using the disjoint set information and index information
-    auto nfa_start = automaton->start.lock();
-    for(auto ps : powersets) {
-
-        // This is the node we are currently building edges from. This is found by
-        // considering all outer edges in our given closure and finding the representatives
-        // of each of the connected nodes. The corresponding DFA node can then be found
-        // by the @indices map
-        auto current = graph[indices[ps.first]];
-        for(auto node : ps.second) {
-            if(auto n_lock = node.lock()) {
-
-                // Mark node as a finishing node
-                // and determine the starting node (should only be one)
-                current->finish = current-> finish || n_lock->finish;
-                if(n_lock == nfa_start) {
-                    start = current;
-                }
+        // Find the NFA nodes reachable by each disjoint range at once. Since ranges
+        // are disjoint, it suffices to look at the beginning of each range.
+        std::vector<unsigned char> points(cuts.begin(), cuts.end() - (cuts.empty() ? 0 : 1));
+        std::vector<std::vector<node_id>> reachable;
+        std::sort(moves.begin(), moves.end());
+        IntervalTree<unsigned char, node_id>::stab(moves, points, reachable);
 
-                // Iterate through the edges of each node in the powerset and
-                // find the corresponding nodes we should be connecting to
-                for(auto it = n_lock->edges.begin(); it != n_lock->edges.end(); it++) {
-                    auto range = it.bounds();
-                    auto nfa_node = it->lock();
-                    auto t_node = indices[*s_components.findSet(nfa_node)];
-                    current->edges.insert(range.first, range.second, std::weak_ptr<Node>(graph[t_node]));
+        // Now link each disjoint range to the node representing the closure of
+        // all NFA nodes reachable by the range, building new nodes as needed.
+        // Adjacent ranges leading to the same node are merged into a single edge.
+        std::vector<transition> edges;
+        node_id last = none;
+        int lower = 0, upper = 0;
+        for(unsigned long i = 0; i + 1 < cuts.size(); i++) {
+            closure.clear();
+            for(auto target : reachable[i]) {
+                closure.insert(target);
+            }
+
+            node_id next = none;
+            if(!closure.empty()) {
+                epsilonClosure(*automaton, closure);
+                powerset targets(closure.begin(), closure.end());
+                std::sort(targets.begin(), targets.end());
+                auto found = nodes.find(targets);
+                if(found == nodes.end()) {
+                    if(graph.size() >= limit) {
+                        throw InvalidRegex("Automaton exceeds state limit", EOF);
+                    }
+                    next = buildNode(false);
+                    nodes[targets] = next;
+                    sets.emplace_back(std::move(targets));
+                } else {
+                    next = found->second;
                 }
+            }
 
+            if(next != last) {
+                if(last != none) {
+                    edges.emplace_back(static_cast<unsigned char>(lower), static_cast<unsigned char>(upper), last);
+                }
+                lower = cuts[i];
             }
+            last = next;
+            upper = cuts[i + 1] - 1;
+        }
+        if(last != none) {
+            edges.emplace_back(static_cast<unsigned char>(lower), static_cast<unsigned char>(upper), last);
         }
+        graph[current].edges = IntervalTree<unsigned char, node_id>(edges);
+    }
+
+    minimize();
+    for(auto& node : graph) {
+        node.freeze();
     }
 }
 
@@ -104,24 +137,15 @@ DFA::DFA(std::shared_ptr<NFA> automaton)
  */
 DFA::DFA(const DFA& other)
     : Automaton(other)
-{
-    // Must find corresponding cursor (generally will be start but
-    // can't be certain of this).
-    if(auto c = other.cursor.lock()) {
-        for(int i = 0; i < other.graph.size(); i++) {
-            if(c == other.graph[i]) {
-                cursor = std::weak_ptr<Node>(graph[i]);
-                break;
-            }
-        }
-    }
-}
+    , cursor(other.cursor)
+{ }
 
 /**
  * Move Constructor
  * ================================
  */
 DFA::DFA(DFA&& other)
+    : cursor(start)
 {
     swap(*this, other);
 }
@@ -143,6 +167,7 @@ DFA& DFA::operator= (DFA other)
 void DFA::swap(DFA& a, DFA& b)
 {
     using std::swap;
+    Automaton::swap(a, b);
     swap(a.cursor, b.cursor);
 }
 
@@ -158,6 +183,15 @@ void DFA::reset()
     cursor = start;
 }
 
+/**
+ * Start
+ * ================================
+ */
+DFA::node_id DFA::getStart() const
+{
+    return start;
+}
+
 /**
  * Final
  * ================================
@@ -166,10 +200,129 @@ void DFA::reset()
  */
 bool DFA::final() const
 {
-    if(auto c = cursor.lock()) {
-        return c->finish;
+    return final(cursor);
+}
+
+bool DFA::final(node_id node) const
+{
+    return graph[node].finish;
+}
+
+/**
+ * Accepting
+ * ================================
+ *
+ * Utility method to see which labeled expressions the current cursor accepts.
+ */
+const std::vector<unsigned int>& DFA::accepting() const
+{
+    return accepting(cursor);
+}
+
+const std::vector<unsigned int>& DFA::accepting(node_id node) const
+{
+    return graph[node].accepts;
+}
+
+/**
+ * Minimize
+ * ================================
+ *
+ * Applies Moore's algorithm. Nodes are initially partitioned by whether they are
+ * finishing (and by the expressions they accept), and blocks are then repeatedly split
+ * by the blocks their edges lead to until no further splits occur. Each remaining
+ * block then becomes a single node.
+ */
+void DFA::minimize()
+{
+    // Build our initial partition
+    std::vector<node_id> blocks(graph.size());
+    std::map<std::pair<bool, std::vector<unsigned int>>, node_id> initial;
+    for(unsigned long i = 0; i < graph.size(); i++) {
+        auto key = std::make_pair(graph[i].finish, graph[i].accepts);
+        blocks[i] = initial.emplace(key, initial.size()).first->second;
+    }
+
+    // Refine until stable. Note a block is never merged with another, so
+    // the partition is stable once the number of blocks stops growing.
+    unsigned long count = initial.size();
+    while(true) {
+        std::vector<node_id> refined(graph.size());
+        std::map<std::pair<node_id, std::vector<transition>>, node_id> signatures;
+        for(unsigned long i = 0; i < graph.size(); i++) {
+            auto key = std::make_pair(blocks[i], transitions(graph[i], blocks));
+            refined[i] = signatures.emplace(key, signatures.size()).first->second;
+        }
+        blocks.swap(refined);
+        if(signatures.size() == count) {
+            break;
+        }
+        count = signatures.size();
+    }
+
+    // Already minimal
+    if(count == graph.size()) {
+        cursor = start;
+        return;
+    }
+
+    // Rebuild our graph with a node per block, using the first node
+    // of each block as the representative of the block
+    std::vector<Node> previous;
+    previous.swap(graph);
+    for(unsigned long i = 0; i < count; i++) {
+        buildNode(false);
+    }
+
+    std::vector<bool> built(count, false);
+    for(unsigned long i = 0; i < previous.size(); i++) {
+        if(!built[blocks[i]]) {
+            built[blocks[i]] = true;
+            auto& current = graph[blocks[i]];
+            current.finish = previous[i].finish;
+            current.accepts = previous[i].accepts;
+            current.edges = IntervalTree<unsigned char, node_id>(transitions(previous[i], blocks));
+        }
+    }
+
+    start = blocks[start];
+    cursor = start;
+}
+
+/**
+ * Transitions
+ * ================================
+ */
+std::vector<DFA::transition> DFA::transitions(const Node& node, const std::vector<node_id>& blocks) const
+{
+    std::vector<transition> result;
+    for(auto it = node.edges.begin(); it != node.edges.end(); it++) {
+        auto bounds = it.bounds();
+        auto block = blocks[*it];
+        if(!result.empty() && std::get<2>(result.back()) == block
+                           && std::get<1>(result.back()) + 1 == bounds.first) {
+            std::get<1>(result.back()) = bounds.second;
+        } else {
+            result.emplace_back(bounds.first, bounds.second, block);
+        }
+    }
+    return result;
+}
+
+/**
+ * Epsilon Closure
+ * ================================
+ *
+ * Adds every node reachable from the passed set via epsilon edges alone. The set
+ * doubles as the worklist; every member is visited exactly once.
+ */
+void DFA::epsilonClosure(const NFA& automaton, SparseSet<node_id>& closure)
+{
+    for(unsigned long i = 0; i < closure.size(); i++) {
+        for(auto e_edge : automaton.graph[closure[i]].epsilon) {
+            closure.insert(e_edge);
+        }
     }
-    return false;
 }
 
 /**
@@ -179,15 +332,39 @@ bool DFA::final() const
  * Attempts to move further along the DFA, returning false if not possible and
  * true otherwise.
 */
-bool DFA::traverse(char input)
+bool DFA::traverse(unsigned char input)
 {
-    if(auto c = cursor.lock()) {
-        auto it = c->edges.find(input, input);
-        if(it != c->edges.end()) {
-            cursor = *it;
-            return true;
-        }
+    return traverse(cursor, input);
+}
+
+bool DFA::traverse(node_id& node, unsigned char input) const
+{
+    auto& edges = graph[node].frozen;
+    auto it = edges.find(input, input);
+    if(it != edges.end()) {
+        node = *it;
+        return true;
     }
 
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * Bytes
+ * ================================
+ *
+ * Edges beyond those stored inline in a node are counted as heap allocations. Since a
+ * built DFA is frozen, its interval trees are empty and ignored.
+ */
+unsigned long DFA::bytes() const
+{
+    unsigned long total = sizeof(DFA) + graph.capacity() * sizeof(Node);
+    for(auto& node : graph) {
+        total += node.accepts.capacity() * sizeof(unsigned int);
+        total += node.epsilon.capacity() * sizeof(node_id);
+        if(node.frozen.size() > 4) {
+            total += node.frozen.size() * (2 * sizeof(unsigned char) + sizeof(node_id));
+        }
+    }
+    return total;
+}
@@ -15,7 +15,13 @@ using namespace sage;
 InvalidRegex::InvalidRegex(std::string message, long index)
 {
     std::stringstream ss;
-    ss << message << " at position " << index << '.' << std::endl;
+    ss << message;
+    if(index == EOF) {
+        ss << " by end of expression.";
+    } else {
+        ss << " at position " << index << '.';
+    }
+    ss << std::endl;
     response = ss.str();
 }
 
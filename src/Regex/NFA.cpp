@@ -18,10 +18,8 @@ using namespace sage;
  */
 NFA::NFA()
 {
-    if(auto s_ptr = start.lock()) {
-        s_ptr->finish = true;
-        finished.insert(start);
-    }
+    graph[start].finish = true;
+    finished.push_back(start);
 }
 
 /**
@@ -32,20 +30,15 @@ NFA::NFA()
  * ending node marked final. This is how the NFA should be built up; that
  * is, by constructing smaller NFAs and joining/concatenating them together.
  */
-NFA::NFA(char c)
+NFA::NFA(unsigned char c)
     :NFA(c, c)
 { }
 
-NFA::NFA(char begin, char end)
+NFA::NFA(unsigned char begin, unsigned char end)
 {
-    if(auto s_ptr = start.lock()) {
-        auto next = buildNode(false);
-        if(auto next_ptr = next.lock()) {
-            finished.insert(next);
-            next_ptr->finish = true;
-            s_ptr->edges.insert(begin, end, next);
-        }
-    }
+    auto next = buildNode(true);
+    finished.push_back(next);
+    graph[start].edges.insert(begin, end, next);
 }
 
 /**
@@ -54,14 +47,8 @@ NFA::NFA(char begin, char end)
  */
 NFA::NFA(const NFA& other)
     : Automaton(other)
-{
-    // Must add all finishing nodes to our set
-    for(auto node : graph) {
-        if(node->finish) {
-            finished.insert(node);
-        }
-    }
-}
+    , finished(other.finished)
+{ }
 
 /**
  * NFA Move Constructor
@@ -90,6 +77,7 @@ NFA& NFA::operator= (NFA other)
 void NFA::swap(NFA& a, NFA& b)
 {
     using std::swap;
+    Automaton::swap(a, b);
     swap(a.finished, b.finished);
 }
 
@@ -102,14 +90,14 @@ void NFA::swap(NFA& a, NFA& b)
  */
 void NFA::join(std::shared_ptr<NFA> tail)
 {
+    auto offset = absorb(*tail);
     auto head = buildNode(false);
-    if(auto h_ptr = head.lock()) {
-        h_ptr->epsilon.push_back(tail->start);
-        h_ptr->epsilon.push_back(start);
-        start = h_ptr;
+    graph[head].epsilon.push_back(tail->start + offset);
+    graph[head].epsilon.push_back(start);
+    start = head;
+    for(auto f_node : tail->finished) {
+        finished.push_back(f_node + offset);
     }
-    finished.insert(tail->finished.begin(), tail->finished.end());
-    graph.insert(graph.end(), tail->graph.begin(), tail->graph.end());
 }
 
 /**
@@ -121,14 +109,15 @@ void NFA::join(std::shared_ptr<NFA> tail)
  */
 void NFA::concatenate(std::shared_ptr<NFA> tail)
 {
-    for(auto node : finished) {
-        if(auto n_ptr = node.lock()) {
-            n_ptr->finish = false;
-            n_ptr->epsilon.push_back(tail->start);
-        }
+    auto offset = absorb(*tail);
+    for(auto f_node : finished) {
+        graph[f_node].finish = false;
+        graph[f_node].epsilon.push_back(tail->start + offset);
+    }
+    finished.clear();
+    for(auto f_node : tail->finished) {
+        finished.push_back(f_node + offset);
     }
-    finished = tail->finished;
-    graph.insert(graph.end(), tail->graph.begin(), tail->graph.end());
 }
 
 /**
@@ -149,12 +138,8 @@ void NFA::kleeneStar()
     // Allow skipping of the current element to the only element
     // while still enabling repetitions as expected
     kleenePlus();
-    if(auto s_ptr = start.lock()) {
-        for(auto f_node : finished) {
-            if(auto f_ptr = f_node.lock()) {
-                s_ptr->epsilon.push_back(f_node);
-            }
-        }
+    for(auto f_node : finished) {
+        graph[start].epsilon.push_back(f_node);
     }
 }
 
@@ -170,19 +155,15 @@ void NFA::kleenePlus()
     auto head = buildNode(false);
     auto tail = buildNode(true);
 
-    if(auto h_ptr = head.lock()) {
-        h_ptr->epsilon.push_back(start);
-        for(auto f_node : finished) {
-            if(auto f_ptr = f_node.lock()) {
-                f_ptr->finish = false;
-                f_ptr->epsilon.push_back(start);
-                f_ptr->epsilon.push_back(tail);
-            }
-        }
+    graph[head].epsilon.push_back(start);
+    for(auto f_node : finished) {
+        graph[f_node].finish = false;
+        graph[f_node].epsilon.push_back(start);
+        graph[f_node].epsilon.push_back(tail);
     }
 
     start = head;
-    finished = weak_set<Node>({ tail });
+    finished.assign(1, tail);
 }
 
 /**
@@ -197,17 +178,32 @@ void NFA::makeOptional()
     auto head = buildNode(false);
     auto tail = buildNode(true);
 
-    if(auto h_ptr = head.lock()) {
-        h_ptr->epsilon.push_back(start);
-        h_ptr->epsilon.push_back(tail);
-        for(auto f_node : finished) {
-            if(auto f_ptr = f_node.lock()) {
-                f_ptr->finish = false;
-                f_ptr->epsilon.push_back(tail);
-            }
-        }
+    graph[head].epsilon.push_back(start);
+    graph[head].epsilon.push_back(tail);
+    for(auto f_node : finished) {
+        graph[f_node].finish = false;
+        graph[f_node].epsilon.push_back(tail);
     }
 
     start = head;
-    finished = weak_set<Node>({ tail });
-}
\ No newline at end of file
+    finished.assign(1, tail);
+}
+
+/**
+ * Label
+ * ================================
+ *
+ * The label is attached to the current finishing nodes, so this should be
+ * called once the NFA has been completely built. Joining labeled NFAs together
+ * then allows a DFA to report which of the original expressions were accepted.
+ */
+void NFA::label(unsigned int index)
+{
+    for(auto f_node : finished) {
+        auto& accepts = graph[f_node].accepts;
+        auto it = std::lower_bound(accepts.begin(), accepts.end(), index);
+        if(it == accepts.end() || *it != index) {
+            accepts.insert(it, index);
+        }
+    }
+}
@@ -8,30 +8,8 @@
 
 using namespace sage;
 
-/**
- * Pooling
- * ================================
- */
-Regex& Regex::fromPool(std::string key, std::string expr, int i)
-{
-    static std::map<std::string, Regex> pool;
-
-    // Search for the key and check for a match. Otherwise we repeat with a modified key and continue the search.
-    // Note I add this somewhat convoluted means of continued search because our above map is ordered and I want 
-    // to avoid any potential clustering
-    auto it = pool.find(key);
-    if(it != pool.end()) {
-        Regex& r = it->second;
-        if(r.expr != expr) {
-            char prepend = static_cast<char>('a' + (expr.size() % 26));
-            return fromPool(prepend + key, expr, (i + 17) % 26);
-        }
-        return r;
-    }
-
-    pool[key] = Regex(expr);
-    return pool[key];
-}
+std::atomic<unsigned long> Regex::state_limit(REGEX_STATE_LIMIT);
+thread_local Regex::Counters Regex::counters;
 
 /**
  * Constructor
@@ -45,26 +23,57 @@ Regex& Regex::fromPool(std::string key, std::string expr, int i)
  * at the 0th index of our vector, and "b" is the name of the Regex at the 1st index.
  * If the same named Regex is later found, it refers to the element already mapped
  * to and not the next indexed value.
+ *
+ * The expression is only compiled if not already present in the cache, or if only compiled
+ * under a larger state limit than the current one (in which case it may exceed the current
+ * limit, and is compiled again to find out). The limit is read once, so a concurrent call to
+ * setStateLimit does not affect an expression already being constructed.
  */
-Regex::Regex(std::string expr)
-    : expr(expr)
+Regex::Regex(std::string expr, int flags)
+    : flags(flags)
+    , expr(expr)
     , front_word_bounded(false)
     , back_word_bounded(false)
 {
-    std::stringstream ss(expr);
-    std::shared_ptr<NFA> nfa = read(ss);
-    automaton = std::make_shared<DFA>(nfa);
+    unsigned long limit = state_limit;
+    auto& cache = RegexCache::global();
+    auto program = cache.find(expr, flags, limit);
+    if(program) {
+        counters.cache_hits++;
+    } else {
+        counters.cache_misses++;
+        std::stringstream ss(expr);
+        std::shared_ptr<NFA> nfa = read(ss);
+        if(nfa->size() > limit) {
+            throw InvalidRegex("Expression exceeds state limit", EOF);
+        }
+
+        auto compiled = std::make_shared<RegexCache::Program>();
+        compiled->automaton = std::make_shared<DFA>(nfa, limit);
+        compiled->front_word_bounded = front_word_bounded;
+        compiled->back_word_bounded = back_word_bounded;
+        compiled->limit = limit;
+        program = cache.insert(expr, flags, compiled);
+        counters.constructions++;
+    }
+
+    automaton = program->automaton;
+    front_word_bounded = program->front_word_bounded;
+    back_word_bounded = program->back_word_bounded;
 }
 
 /**
  * Copy Constructor
  * ================================
+ *
+ * The automaton is never modified once built, so it is shared rather than copied.
  */
 Regex::Regex(const Regex& other)
-    : expr(other.expr)
+    : flags(other.flags)
+    , expr(other.expr)
     , front_word_bounded(other.front_word_bounded)
     , back_word_bounded(other.back_word_bounded)
-    , automaton(std::make_shared<DFA>(*other.automaton))
+    , automaton(other.automaton)
 { }
 
 /**
@@ -94,6 +103,7 @@ Regex& Regex::operator= (Regex other)
 void Regex::swap(Regex& a, Regex& b)
 {
     using std::swap;
+    swap(a.flags, b.flags);
     swap(a.expr, b.expr);
     swap(a.front_word_bounded, b.front_word_bounded);
     swap(a.back_word_bounded, b.back_word_bounded);
@@ -105,15 +115,17 @@ void Regex::swap(Regex& a, Regex& b)
  * ================================
  *
  * Returns the index of the string in which the substring starting
- * at the specified index matches.
+ * at the specified index matches, or -1 if there is no such index.
  */
-int Regex::find(std::string search)
+int Regex::find(const std::string& search) const
 {
     for(int i = 0; i < search.size(); i++) {
         if(matches(search, i)) {
             return i;
         }
     }
+
+    return -1;
 }
 
 /**
@@ -122,28 +134,74 @@ int Regex::find(std::string search)
  *
  * Determines if the string at the given index matches correctly.
  */
-bool Regex::matches(std::string search, int index)
+bool Regex::matches(const std::string& search, int index) const
 {
     // Check that the front matches correctly
     if(front_word_bounded && index > 0) {
-        Regex whitespace = Regex::fromPool(REGEX_POOL_WHITESPACE, REGEX_EXPR_WHITESPACE);
+        static const Regex whitespace(REGEX_EXPR_WHITESPACE);
         if(!whitespace.matches(search.substr(index - 1, 1))) {
             return false;
         }
     }
 
     // Begin traversal of automaton
-    automaton->reset();
-    for(int i = index; i < search.size(); i++) {
-        if(!automaton->traverse(search[i])) {
-            return false;
-        }
+    auto cursor = automaton->getStart();
+    int i = index;
+    while(i < search.size() && automaton->traverse(cursor, search[i])) {
+        i++;
+    }
+    counters.transitions += i - index;
+    if(i < search.size()) {
+        return false;
     }
 
     // There is no need to check for the back word boundary since
     // we always search the entirety of the string. Consequently,
     // we necessarily reach the end.
-    return automaton->final();
+    return automaton->final(cursor);
+}
+
+/**
+ * State Limit
+ * ================================
+ */
+void Regex::setStateLimit(unsigned long limit)
+{
+    state_limit = limit;
+}
+
+/**
+ * Counters
+ * ================================
+ *
+ * Counters are kept per thread, so a snapshot only reflects work done by the calling
+ * thread. Subtracting an earlier snapshot yields the work done in between.
+ */
+Regex::Counters::Counters()
+    : constructions(0)
+    , cache_hits(0)
+    , cache_misses(0)
+    , transitions(0)
+{ }
+
+Regex::Counters Regex::Counters::operator- (const Counters& other) const
+{
+    Counters result;
+    result.constructions = constructions - other.constructions;
+    result.cache_hits = cache_hits - other.cache_hits;
+    result.cache_misses = cache_misses - other.cache_misses;
+    result.transitions = transitions - other.transitions;
+    return result;
+}
+
+Regex::Counters Regex::getCounters()
+{
+    return counters;
+}
+
+void Regex::resetCounters()
+{
+    counters = Counters();
 }
 
 /**
@@ -228,11 +286,23 @@ std::shared_ptr<NFA> Regex::read(std::stringstream& ss, int counter)
             case REGEX_RANGE_END:
                 throw InvalidRegex("Unexpected '%c'", c, ss.tellg());
             case REGEX_WILDCARD:
-                next = std::make_shared<NFA>(0, std::numeric_limits<char>::max());
+                next = buildCodePoints(0, (flags & FLAG_UTF8) ? 0x10FFFF : std::numeric_limits<unsigned char>::max());
                 break;
-            default:
-                next = std::make_shared<NFA>(c);
+            default: {
+                unsigned long code = readCodePoint(ss, c);
+                next = buildCodePoints(code, code);
                 break;
+            }
+        }
+
+        // Allow for counted repetitions, which may be stacked (i.e. a{2}{3} is a{6}). The
+        // NFA is returned as is if the '{' was instead read literally.
+        while(next != nullptr && ss.peek() == REGEX_REPL_START) {
+            auto repeated = readRepetition(ss, next);
+            if(repeated == next) {
+                break;
+            }
+            next = repeated;
         }
 
         // Allow for repetition operations
@@ -307,17 +377,20 @@ std::shared_ptr<NFA> Regex::readRange(std::stringstream& ss)
         // invalid range has been specified. Ranges between characters are
         // perfectly valid, but it is important that they are actually in order
         } else if(begin != REGEX_HYPHEN) {
+            unsigned long lower = readCodePoint(ss, begin);
             if(ss.peek() == '-') {
                 char end; ss.get();
                 if(!ss.get(end)) {
                     throw InvalidRegex("End range of '%c' not specified", REGEX_HYPHEN, ss.tellg());
-                } else if(begin > end) {
+                }
+                unsigned long upper = readCodePoint(ss, end);
+                if(lower > upper) {
                     throw InvalidRegex("Range starting at '%c' not ordered correctly", begin, ss.tellg());
                 } else {
-                    components.emplace_back(std::make_shared<NFA>(begin, end));
+                    components.emplace_back(buildCodePoints(lower, upper));
                 }
             } else {
-                components.emplace_back(std::make_shared<NFA>(begin));
+                components.emplace_back(buildCodePoints(lower, lower));
             }
 
         // Otherwise we encountered a hypher, but this should only occur after reading in a character
@@ -343,6 +416,70 @@ std::shared_ptr<NFA> Regex::readRange(std::stringstream& ss)
     return head;
 }
 
+/**
+ * Reads Code Point
+ * ================================
+ *
+ * Decodes the UTF-8 sequence beginning with the passed byte, verifying that the
+ * expected number of continuation bytes follow.
+ */
+unsigned long Regex::readCodePoint(std::stringstream& ss, char lead)
+{
+    auto byte = static_cast<unsigned char>(lead);
+    if(!(flags & FLAG_UTF8) || byte < 0x80) {
+        return byte;
+    }
+
+    int length = utf8_length(byte);
+    if(length == 0) {
+        throw InvalidRegex("Invalid UTF-8 lead byte", ss.tellg());
+    }
+
+    unsigned long code = byte & (0x7F >> length);
+    for(int i = 1; i < length; i++) {
+        int next = ss.get();
+        if(next == EOF || (next & 0xC0) != 0x80) {
+            throw InvalidRegex("Invalid UTF-8 continuation byte", ss.tellg());
+        }
+        code = (code << 6) | (next & 0x3F);
+    }
+
+    return code;
+}
+
+/**
+ * Build Code Points
+ * ================================
+ *
+ * Outside of UTF-8 mode, code points are just bytes. Otherwise the range is split into
+ * sequences of byte ranges, each of which becomes a chain of NFAs. Note the resulting DFA
+ * shares common prefixes/suffixes of these sequences once determinized and minimized.
+ */
+std::shared_ptr<NFA> Regex::buildCodePoints(unsigned long lower, unsigned long upper) const
+{
+    if(!(flags & FLAG_UTF8)) {
+        return std::make_shared<NFA>(static_cast<unsigned char>(lower), static_cast<unsigned char>(upper));
+    }
+
+    std::vector<utf8_sequence> sequences;
+    utf8_ranges(lower, upper, sequences);
+
+    std::list<std::shared_ptr<NFA>> components;
+    for(auto sequence : sequences) {
+        auto chain = std::make_shared<NFA>();
+        for(auto range : sequence) {
+            chain->concatenate(std::make_shared<NFA>(range.first, range.second));
+        }
+        components.push_back(chain);
+    }
+
+    if(components.empty()) {
+        throw InvalidRegex("Range does not contain any valid code points", EOF);
+    }
+
+    return collapseNFAs(components);
+}
+
 /**
  * Reads Special
  * ================================
@@ -405,4 +542,83 @@ std::shared_ptr<NFA> Regex::readSpecial(std::stringstream& ss)
     }
 
     return readRange(range);
-}
\ No newline at end of file
+}
+
+/**
+ * Reads Repetition
+ * ================================
+ *
+ * The NFA is copied once per required repetition, while optional repetitions are nested
+ * within one another (i.e. a{1,3} becomes a(a(a)?)?) so that at most one copy is entered at
+ * any point. This keeps the resulting DFA from growing beyond the number of repetitions, and
+ * minimization of the DFA then merges any remaining equivalent states.
+ *
+ * The size of the NFA is verified against the state limit before any copying takes place. This
+ * only estimates the size of the resulting automaton, and says nothing of the time to build it
+ * (see Regex::setStateLimit).
+ */
+std::shared_ptr<NFA> Regex::readRepetition(std::stringstream& ss, std::shared_ptr<NFA> nfa)
+{
+    // Only regarded as a repetition if a count follows
+    ss.get();
+    if(!std::isdigit(ss.peek())) {
+        ss.unget();
+        return nfa;
+    }
+
+    unsigned long lower = 0, upper = 0;
+    bool bounded = true;
+    auto position = ss.tellg();
+    if(!(ss >> lower)) {
+        throw InvalidRegex("Repetition count out of range", position);
+    }
+    if(ss.peek() == ',') {
+        ss.get();
+        if(std::isdigit(ss.peek())) {
+            position = ss.tellg();
+            if(!(ss >> upper)) {
+                throw InvalidRegex("Repetition count out of range", position);
+            }
+        } else {
+            bounded = false;
+        }
+    } else {
+        upper = lower;
+    }
+
+    // Bounds are compared by division, since multiplying them by the size could overflow
+    unsigned long states = std::max<unsigned long>(nfa->size(), 1), limit = state_limit;
+    if(ss.get() != REGEX_REPL_END) {
+        throw InvalidRegex("Expected '%c'", REGEX_REPL_END, ss.tellg());
+    } else if(bounded && upper < lower) {
+        throw InvalidRegex("Repetition bounds not ordered correctly", ss.tellg());
+    } else if(bounded ? upper > limit / states : lower >= limit / states) {
+        throw InvalidRegex("Repetition exceeds state limit", ss.tellg());
+    }
+
+    // Required repetitions
+    auto result = std::make_shared<NFA>();
+    for(unsigned long i = 0; i < lower; i++) {
+        result->concatenate(std::make_shared<NFA>(*nfa));
+    }
+
+    // Optional repetitions
+    if(!bounded) {
+        auto tail = std::make_shared<NFA>(*nfa);
+        tail->kleeneStar();
+        result->concatenate(tail);
+    } else if(upper > lower) {
+        std::shared_ptr<NFA> tail;
+        for(unsigned long i = lower; i < upper; i++) {
+            auto copy = std::make_shared<NFA>(*nfa);
+            if(tail) {
+                copy->concatenate(tail);
+            }
+            copy->makeOptional();
+            tail = copy;
+        }
+        result->concatenate(tail);
+    }
+
+    return result;
+}
@@ -0,0 +1,160 @@
+/**
+ * RegexCache.cpp
+ */
+
+#include "Regex/RegexCache.h"
+
+using namespace sage;
+
+/**
+ * Statistics Constructor
+ * ================================
+ */
+RegexCache::Statistics::Statistics()
+    : hits(0)
+    , misses(0)
+    , evictions(0)
+    , entries(0)
+    , bytes(0)
+{ }
+
+/**
+ * Constructor
+ * ================================
+ */
+RegexCache::RegexCache(unsigned long budget)
+    : budget(budget)
+{ }
+
+/**
+ * Global
+ * ================================
+ *
+ * Constructed on first use, so that Regexes built during static initialization
+ * may still use the cache.
+ */
+RegexCache& RegexCache::global()
+{
+    static RegexCache cache;
+    return cache;
+}
+
+/**
+ * Find
+ * ================================
+ *
+ * A hit moves the entry to the front of the list, marking it most recently used. A program
+ * compiled under a larger limit than the passed one is of no use to the caller, who must
+ * compile the expression again, and so is regarded as a miss.
+ */
+std::shared_ptr<const RegexCache::Program> RegexCache::find(const std::string& expr, int flags, unsigned long limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key(expr, flags));
+    if(it == index.end() || it->second->program->limit > limit) {
+        statistics.misses++;
+        return nullptr;
+    }
+
+    statistics.hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->program;
+}
+
+/**
+ * Insert
+ * ================================
+ *
+ * Programs are compiled without holding the lock, so two threads missing on the same
+ * expression may both compile it. The first to insert wins, and both then share its program.
+ * A program compiled under a smaller state limit is valid wherever the cached one is (and
+ * more), so replaces it instead.
+ */
+std::shared_ptr<const RegexCache::Program> RegexCache::insert(const std::string& expr, int flags,
+                                                              std::shared_ptr<const Program> program)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    key id(expr, flags);
+    auto it = index.find(id);
+    if(it != index.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        if(program->limit < it->second->program->limit) {
+            statistics.bytes -= it->second->bytes;
+            it->second->program = program;
+            it->second->bytes = size(expr, *program);
+            statistics.bytes += it->second->bytes;
+            evict();
+        }
+        return it->second->program;
+    }
+
+    Entry entry;
+    entry.id = id;
+    entry.program = program;
+    entry.bytes = size(expr, *program);
+    entries.push_front(entry);
+    index[id] = entries.begin();
+
+    statistics.entries++;
+    statistics.bytes += entry.bytes;
+    evict();
+    return program;
+}
+
+/**
+ * Size
+ * ================================
+ */
+unsigned long RegexCache::size(const std::string& expr, const Program& program)
+{
+    return sizeof(Entry) + 2 * expr.capacity() + program.automaton->bytes();
+}
+
+/**
+ * Budget
+ * ================================
+ */
+void RegexCache::setBudget(unsigned long limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = limit;
+    evict();
+}
+
+/**
+ * Evict
+ * ================================
+ *
+ * The most recently used entry is never evicted, even if it alone exceeds the budget,
+ * so that a just inserted program is always found again by an immediate lookup.
+ */
+void RegexCache::evict()
+{
+    while(statistics.bytes > budget && entries.size() > 1) {
+        auto& last = entries.back();
+        statistics.bytes -= last.bytes;
+        statistics.entries--;
+        statistics.evictions++;
+        index.erase(last.id);
+        entries.pop_back();
+    }
+}
+
+/**
+ * Accessors
+ * ================================
+ */
+RegexCache::Statistics RegexCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void RegexCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    statistics.entries = 0;
+    statistics.bytes = 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * RegexSet.cpp
+ */
+
+#include "Regex/RegexSet.h"
+
+using namespace sage;
+
+/**
+ * Constructor
+ * ================================
+ */
+RegexSet::RegexSet()
+{ }
+
+/**
+ * Add
+ * ================================
+ *
+ * The expression is read in again (as opposed to reusing the DFA of the passed
+ * Regex) since only NFAs can be labeled and joined together.
+ */
+unsigned int RegexSet::add(const Regex& r)
+{
+    for(unsigned long i = 0; i < exprs.size(); i++) {
+        if(exprs[i] == r.expr && flags[i] == r.flags) {
+            return static_cast<unsigned int>(i);
+        }
+    }
+
+    // Note reading sets the word boundaries of our temporary
+    Regex parsed;
+    parsed.flags = r.flags;
+    parsed.front_word_bounded = false;
+    parsed.back_word_bounded = false;
+    std::stringstream ss(r.expr);
+    auto nfa = parsed.read(ss);
+    nfa->label(static_cast<unsigned int>(exprs.size()));
+
+    // Must rebuild the automaton to include the new expression
+    automaton = nullptr;
+    exprs.push_back(r.expr);
+    flags.push_back(r.flags);
+    front_word_bounded.push_back(parsed.front_word_bounded);
+    back_word_bounded.push_back(parsed.back_word_bounded);
+    components.push_back(nfa);
+    return static_cast<unsigned int>(exprs.size() - 1);
+}
+
+/**
+ * Compile
+ * ================================
+ *
+ * Joins all labeled NFAs together under a new starting node. Note the labeled
+ * NFAs are left untouched so the set can be compiled again if expanded.
+ */
+void RegexSet::compile()
+{
+    auto head = std::make_shared<NFA>();
+    for(auto nfa : components) {
+        head->join(nfa);
+    }
+
+    automaton = std::make_shared<DFA>(head);
+    Regex::counters.constructions++;
+}
+
+/**
+ * Is Compiled
+ * ================================
+ *
+ * Adding an expression discards the automaton, so one present reflects every expression.
+ */
+bool RegexSet::isCompiled() const
+{
+    return automaton != nullptr;
+}
+
+/**
+ * Size
+ * ================================
+ */
+unsigned long RegexSet::size() const
+{
+    return exprs.size();
+}
+
+/**
+ * Matches
+ * ================================
+ *
+ * Traverses the combined automaton along the token, recording the current position
+ * for every expression accepted along the way. Expressions bounded at the back must
+ * match the entirety of the token (as is the case in Scanner::next).
+ */
+void RegexSet::matches(const std::string& token, bool front_bounded, std::vector<unsigned long>& lengths)
+{
+    if(!automaton) {
+        compile();
+    }
+
+    lengths.assign(exprs.size(), 0);
+    auto node = automaton->getStart();
+    unsigned long i = 0;
+    for(; i < token.size(); i++) {
+        if(!automaton->traverse(node, token[i])) {
+            break;
+        }
+        for(auto index : automaton->accepting(node)) {
+            if(!back_word_bounded[index] || i + 1 == token.size()) {
+                lengths[index] = i + 1;
+            }
+        }
+    }
+    Regex::counters.transitions += i;
+
+    // Front bounded expressions cannot match if we are not on a boundary
+    if(!front_bounded) {
+        for(unsigned long i = 0; i < exprs.size(); i++) {
+            if(front_word_bounded[i]) {
+                lengths[i] = 0;
+            }
+        }
+    }
+}
+
+/**
+ * Longest
+ * ================================
+ *
+ * Continues traversing for as long as possible, remembering the last position
+ * at which some expression was accepted.
+ */
+unsigned long RegexSet::longest(const std::string& text, unsigned long index, const std::vector<unsigned int>*& accepted)
+{
+    if(!automaton) {
+        compile();
+    }
+
+    unsigned long length = 0;
+    auto node = automaton->getStart();
+    unsigned long i = index;
+    for(; i < text.size(); i++) {
+        if(!automaton->traverse(node, text[i])) {
+            break;
+        } else if(!automaton->accepting(node).empty()) {
+            length = i + 1 - index;
+            accepted = &automaton->accepting(node);
+        }
+    }
+    Regex::counters.transitions += i - index;
+
+    return length;
+}
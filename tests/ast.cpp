@@ -0,0 +1,273 @@
+/**
+ * ast.cpp
+ *
+ * Tests of trees built by the Parser: their serialized form, traversals and indices.
+ */
+
+#include <algorithm>
+
+#include "Parser/ASTIndex.h"
+#include "Parser/ASTReader.h"
+#include "Parser/Parser.h"
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * Utilities
+ * ================================
+ */
+namespace
+{
+    // The tree of the given input
+    std::shared_ptr<AST> parse(const std::string& grammar, const std::string& input)
+    {
+        Parser parser(test::path(grammar));
+        std::stringstream stream(input);
+        return parser.parse(stream);
+    }
+
+    std::string serialize(const AST& ast)
+    {
+        std::stringstream output;
+        ast.serialize(output);
+        return output.str();
+    }
+
+    // Whether the serialized node mirrors the given node (and their subtrees one another)
+    bool mirrors(const ASTReader::Node& node, const AST& ast)
+    {
+        if(node.getTag() != ast.getTag() || node.getStart() != ast.getStart() || node.getEnd() != ast.getEnd()
+                || node.getChildCount() != ast.getChildCount()) {
+            return false;
+        } else if(ast.getTag() == AST::TERMINAL) {
+            return node.getString() == ast.getToken();
+        } else if(ast.getTag() == AST::NONTERMINAL
+                  && (node.getString() != ast.getType() || node.getRule() != ast.getRule())) {
+            return false;
+        }
+
+        for(unsigned long i = 0; i < ast.getChildCount(); i++) {
+            if(!mirrors(node.getChild(i), *ast.getChild(i))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Visits every node of the serialized tree, returning the number visited
+    unsigned long walk(const ASTReader::Node& node)
+    {
+        unsigned long count = 1;
+        if(node.getChildCount() > 0) {
+            for(auto child = node.getChild(0); ; child = child.getNextSibling()) {
+                count += walk(child);
+                if(!child.hasNextSibling()) {
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+}
+
+/**
+ * Serialization
+ * ================================
+ */
+SAGE_TEST(ast_serializes_and_reads_back)
+{
+    auto ast = parse("grammars/arithmetic.peg", "195 + (186 * 32) - 14 / 9");
+    CHECK(ast != nullptr);
+    if(!ast) {
+        return;
+    }
+
+    auto data = serialize(*ast);
+    ASTReader reader(data.data(), data.size());
+    CHECK(mirrors(reader.getRoot(), *ast));
+
+    unsigned long count = 0;
+    for(auto& node : ast->preorder()) {
+        (void) node;
+        count++;
+    }
+    CHECK(reader.size() == count && walk(reader.getRoot()) == count);
+
+    // Fixed width integers are little endian, whatever the host
+    const unsigned long offset = sizeof(AST_MAGIC) - 1;
+    CHECK(data.compare(0, offset, AST_MAGIC) == 0);
+    for(unsigned long i = 0; i < 4; i++) {
+        CHECK(static_cast<unsigned char>(data[offset + i]) == ((count >> (8 * i)) & 0xFF));
+    }
+}
+
+SAGE_TEST(ast_reader_rejects_malformed_trees)
+{
+    auto ast = parse("grammars/arithmetic.peg", "1 + (2 * 3)");
+    auto data = serialize(*ast);
+    for(unsigned long length = 0; length < data.size(); length++) {
+        CHECK_THROWS(walk(ASTReader(data.data(), length).getRoot()), InvalidAST);
+    }
+
+    auto corrupt = data;
+    corrupt[0] = 'X';
+    CHECK_THROWS(ASTReader(corrupt.data(), corrupt.size()), InvalidAST);
+}
+
+SAGE_TEST(ast_serialize_rejects_what_the_format_cannot_hold)
+{
+    auto leaf = std::make_shared<AST>("x", 0, 1);
+    AST valid("Rule", leaf, 0xFFFE);
+    CHECK(!serialize(valid).empty());
+
+    AST invalid("Rule", leaf, 70000);
+    std::stringstream output;
+    CHECK_THROWS(invalid.serialize(output), InvalidAST);
+    CHECK(output.str().empty());
+}
+
+SAGE_TEST(ast_varints_round_trip)
+{
+    for(unsigned long value : { 0UL, 1UL, 127UL, 128UL, 300UL, 0xFFFFFFFFUL, ~0UL }) {
+        std::string encoded;
+        ASTReader::writeVarint(encoded, value);
+        unsigned long offset = 0;
+        CHECK(ASTReader::readVarint(encoded.data(), encoded.size(), offset) == value);
+        CHECK(offset == encoded.size());
+    }
+    CHECK(ASTReader::zigzag(0) == 0 && ASTReader::zigzag(-1) == 1 && ASTReader::zigzag(1) == 2);
+    for(long value : { 0L, -1L, 1L, -300L, 300L }) {
+        CHECK(ASTReader::unzigzag(ASTReader::zigzag(value)) == value);
+    }
+}
+
+/**
+ * Traversal
+ * ================================
+ */
+namespace
+{
+    // Sum -> [ 1, Value -> 2 ]
+    std::shared_ptr<AST> small()
+    {
+        auto value = std::make_shared<AST>("Value", std::make_shared<AST>("2", 4, 5), 1, 4);
+        std::vector<std::shared_ptr<AST>> branches = { std::make_shared<AST>("1", 0, 1), value };
+        return std::make_shared<AST>("Sum", std::make_shared<AST>(branches), 0, 0);
+    }
+
+    // The token or type of each node visited, suffixed by its depth
+    std::string visit(const AST::Traversal& traversal)
+    {
+        std::string visited;
+        for(auto it = traversal.begin(); it != traversal.end(); ++it) {
+            auto& text = (it->getTag() == AST::TERMINAL) ? it->getToken() : it->getType();
+            visited += (text.empty() ? "*" : text) + std::to_string(it.getDepth()) + " ";
+        }
+        return visited;
+    }
+}
+
+SAGE_TEST(ast_traverses_in_both_orders)
+{
+    auto ast = small();
+    CHECK(visit(ast->preorder()) == "Sum0 *1 12 Value2 23 ");
+    CHECK(visit(ast->postorder()) == "12 23 Value2 *1 Sum0 ");
+
+    std::stringstream formatted;
+    ast->format(formatted);
+    CHECK(formatted.str() == "|- Sum\n|---------- 1\n|---------- Value\n|--------------- 2\n");
+}
+
+SAGE_TEST(ast_handles_deep_trees_without_recursion)
+{
+    // Deep enough to overflow the stack were each level a call
+    const unsigned long depth = 2000000;
+    {
+        auto ast = std::make_shared<AST>("x", 0, 1);
+        for(unsigned long i = 0; i < depth; i++) {
+            ast = std::make_shared<AST>("Nested", ast, 0, 0);
+        }
+
+        unsigned long visited = 0, deepest = 0;
+        for(auto it = ast->preorder().begin(); it != AST::Iterator(); ++it) {
+            visited++;
+            deepest = std::max(deepest, it.getDepth());
+        }
+        CHECK(visited == depth + 1 && deepest == depth);
+
+        auto last = ast->postorder().begin();
+        CHECK(last->getTag() == AST::TERMINAL && last.getDepth() == depth);
+    }
+
+    // Nodes shared with another tree outlive the tree being freed
+    auto shared = std::make_shared<AST>("y", 0, 1);
+    {
+        auto ast = std::make_shared<AST>("Outer", std::make_shared<AST>("Inner", shared, 0, 0), 0, 0);
+    }
+    CHECK(shared.use_count() == 1 && shared->getToken() == "y");
+}
+
+/**
+ * Indices
+ * ================================
+ */
+SAGE_TEST(ast_index_finds_rules)
+{
+    auto ast = parse("grammars/arithmetic.peg", "1 + (2 * 3)");
+    ASTIndex index(ast);
+
+    // Positions are those of a preorder traversal
+    std::vector<const AST*> nodes;
+    for(auto& node : ast->preorder()) {
+        nodes.push_back(&node);
+    }
+    CHECK(index.size() == nodes.size() && &index.getNode(0) == ast.get());
+
+    auto value = index.getRule("Value");
+    CHECK(value != Tracer::NO_RULE && index.getRule("Missing") == Tracer::NO_RULE);
+    std::vector<unsigned long> values;
+    for(unsigned long i = 0; i < nodes.size(); i++) {
+        CHECK(&index.getNode(i) == nodes[i]);
+        if(nodes[i]->getTag() == AST::NONTERMINAL && nodes[i]->getType() == "Value") {
+            values.push_back(i);
+        }
+    }
+    CHECK(index.findAll(value) == values && values.size() == 4);
+
+    // Values lie at 0-1, 4-11, 5-6 and 9-10
+    CHECK(index.findFirst(value, 0, 11) == values[0]);
+    CHECK(index.findFirst(value, 1, 11) == values[1]);
+    CHECK(index.findFirst(value, 5, 11) == values[2]);
+    CHECK(index.findFirst(value, 7, 10) == values[3]);
+    CHECK(index.findFirst(value, 7, 9) == ASTIndex::NO_NODE);
+}
+
+SAGE_TEST(ast_index_finds_parents_and_ancestors)
+{
+    auto ast = parse("grammars/arithmetic.peg", "1 + (2 * 3)");
+    ASTIndex index(ast);
+    CHECK(index.getParent(0) == ASTIndex::NO_NODE);
+
+    for(unsigned long i = 1; i < index.size(); i++) {
+        auto& parent = index.getNode(index.getParent(i));
+        bool found = false;
+        for(unsigned long c = 0; c < parent.getChildCount(); c++) {
+            found = found || parent.getChild(c).get() == &index.getNode(i);
+        }
+        CHECK(found);
+    }
+
+    // The innermost Expression containing "2" is that within the parentheses
+    auto two = index.findFirst(index.getRule("Value"), 5, 6);
+    auto expression = index.getAncestor(two, index.getRule("Expression"));
+    CHECK(expression != ASTIndex::NO_NODE && expression != 0);
+    CHECK(index.getNode(expression).getStart() == 5 && index.getNode(expression).getEnd() == 10);
+    CHECK(index.getAncestor(expression, index.getRule("Expression")) == ASTIndex::NO_NODE);
+
+    // The root is the Sum the start rule consists of
+    auto sum = index.getAncestor(two, index.getRule("Sum"));
+    CHECK(index.getParent(sum) == expression);
+    CHECK(index.getAncestor(sum, index.getRule("Sum")) == 0);
+}
@@ -0,0 +1,105 @@
+/**
+ * main.cpp
+ *
+ * Runs the tests registered under /tests, reporting each failed check and a summary. The
+ * exit status is nonzero if any test failed.
+ *
+ * Usage: tests [--root DIR] [--filter SUBSTRING]
+ *
+ * Files are read relative to DIR, the root of the repository (by default the working directory).
+ */
+
+#include <exception>
+#include <iostream>
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * State
+ * ================================
+ */
+namespace
+{
+    std::string root = ".";
+    std::string filter;
+
+    // Failed checks of the running test
+    unsigned long failures = 0;
+}
+
+/**
+ * Registration
+ * ================================
+ */
+std::vector<test::Case>& test::cases()
+{
+    static std::vector<Case> registered;
+    return registered;
+}
+
+test::Registration::Registration(const std::string& name, std::function<void()> body)
+{
+    cases().push_back({ name, body });
+}
+
+/**
+ * Failures
+ * ================================
+ */
+void test::fail(const char* file, int line, const std::string& expression)
+{
+    std::cout << "    " << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+    failures++;
+}
+
+/**
+ * Paths
+ * ================================
+ */
+std::string test::path(const std::string& name)
+{
+    return root + "/" + name;
+}
+
+/**
+ * Main
+ * ================================
+ */
+int main(int argc, char** argv)
+{
+    for(int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if(flag == "--root") {
+            root = argv[i + 1];
+        } else if(flag == "--filter") {
+            filter = argv[i + 1];
+        } else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    unsigned long run = 0, failed = 0;
+    for(auto& c : test::cases()) {
+        if(c.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        run++;
+        failures = 0;
+        try {
+            c.body();
+        } catch(std::exception& e) {
+            std::cout << "    uncaught exception: " << e.what() << std::endl;
+            failures++;
+        }
+
+        std::cout << ((failures == 0) ? "[ ok ] " : "[FAIL] ") << c.name << std::endl;
+        failed += (failures == 0) ? 0 : 1;
+    }
+
+    std::cout << run - failed << "/" << run << " tests passed" << std::endl;
+    return (failed == 0) ? 0 : 1;
+}
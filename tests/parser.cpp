@@ -0,0 +1,575 @@
+/**
+ * parser.cpp
+ *
+ * Tests of the Parser and the options it parses with.
+ */
+
+#include <cstdio>
+
+#include "Parser/Parser.h"
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * Utilities
+ * ================================
+ */
+namespace
+{
+    // The formatted tree, or an empty string if none
+    std::string format(std::shared_ptr<AST> ast)
+    {
+        std::stringstream output;
+        if(ast) {
+            ast->format(output);
+        }
+        return output.str();
+    }
+
+    // The formatted tree of the given input, or an empty string if it does not parse
+    std::string parse(Parser& parser, const std::string& input, const ParseOptions& options = ParseOptions())
+    {
+        std::stringstream stream(input);
+        return format(parser.parse(stream, options));
+    }
+
+    // The contents of a tracer's dump
+    std::string dump(const Tracer& tracer)
+    {
+        std::FILE* file = std::tmpfile();
+        bool dumped = tracer.dump(fileno(file));
+        std::rewind(file);
+
+        std::string contents;
+        for(int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+            contents += static_cast<char>(c);
+        }
+        std::fclose(file);
+        return dumped ? contents : "";
+    }
+
+    // Reads a value of the given type out of a dump, advancing past it
+    template<typename T>
+    T read(const std::string& contents, unsigned long& offset)
+    {
+        T value;
+        auto begin = contents.data() + offset;
+        std::copy(begin, begin + sizeof(T), reinterpret_cast<char*>(&value));
+        offset += sizeof(T);
+        return value;
+    }
+
+    const std::vector<std::string> arithmetic = {
+        "195 + (186 * 32) - 14 / 9",
+        "1 + 2 * (3 - 4) / 5 - 66",
+        "((((7))))",
+        "(1+2",
+        "1 + 2 x",
+    };
+}
+
+/**
+ * Multiple Patterns
+ * ================================
+ */
+SAGE_TEST(parser_multi_pattern_builds_identical_trees)
+{
+    Parser plain(test::path("grammars/arithmetic.peg"));
+    Parser multi(test::path("grammars/arithmetic.peg"), Parser::OPTION_MULTI_PATTERN);
+    for(auto& input : arithmetic) {
+        CHECK(parse(plain, input) == parse(multi, input));
+    }
+    CHECK(!parse(multi, arithmetic[0]).empty());
+    CHECK(parse(multi, "(1+2").empty());
+
+    Parser palindrome(test::path("grammars/palindrome.peg"), Parser::OPTION_MULTI_PATTERN);
+    CHECK(!parse(palindrome, "a b c b a").empty());
+    CHECK(parse(palindrome, "a b").empty());
+}
+
+/**
+ * Token Streams
+ * ================================
+ */
+SAGE_TEST(parser_token_stream_builds_identical_trees)
+{
+    Parser plain(test::path("grammars/arithmetic.peg"));
+    Parser tokens(test::path("grammars/arithmetic.peg"), Parser::OPTION_TOKEN_STREAM);
+    for(auto& input : arithmetic) {
+        CHECK(parse(plain, input) == parse(tokens, input));
+    }
+}
+
+SAGE_TEST(parser_declared_tokens_lex_the_input)
+{
+    Parser parser(test::path("tests/grammars/tokens.peg"));
+    Parser plain(test::path("grammars/arithmetic.peg"));
+    CHECK(parse(parser, "1+(22*3)\n - 4") == parse(plain, "1 + (22 * 3) - 4"));
+    CHECK(parse(parser, "1 + a").empty());
+    CHECK(parse(parser, "(1").empty());
+}
+
+SAGE_TEST(lexer_splits_tokens_by_maximal_munch)
+{
+    auto set = std::make_shared<RegexSet>();
+    auto keyword = set->add(Regex("if"));
+    auto word = set->add(Regex("[a-z]+"));
+    auto number = set->add(Regex("[0-9]+"));
+
+    Lexer lexer(set);
+    std::stringstream input("if iffy 42");
+    std::string text;
+    std::vector<Token> tokens;
+    CHECK(lexer.tokenize(input, text, tokens));
+    CHECK(tokens.size() == 3);
+    CHECK(tokens[0].offset == 0 && tokens[0].length == 2);
+    CHECK(lexer.accepts(tokens[0], keyword) && lexer.accepts(tokens[0], word));
+    CHECK(tokens[1].offset == 3 && tokens[1].length == 4);
+    CHECK(!lexer.accepts(tokens[1], keyword) && lexer.accepts(tokens[1], word));
+    CHECK(lexer.accepts(tokens[2], number) && !lexer.accepts(tokens[2], word));
+
+    std::stringstream invalid("if ?");
+    CHECK(!lexer.tokenize(invalid, text, tokens));
+    CHECK(tokens.size() == 1);
+}
+
+SAGE_TEST(lexer_reuses_a_compiled_set)
+{
+    auto set = std::make_shared<RegexSet>();
+    set->add(Regex("[a-z]+"));
+    set->compile();
+    Regex delimiter(REGEX_EXPR_WHITESPACE);
+
+    auto before = Regex::getCounters();
+    Lexer lexer(set);
+    CHECK((Regex::getCounters() - before).constructions == 0);
+
+    auto fresh = std::make_shared<RegexSet>();
+    fresh->add(Regex("[a-z]+"));
+    Lexer other(fresh);
+    CHECK(fresh->isCompiled());
+}
+
+/**
+ * Batches
+ * ================================
+ */
+SAGE_TEST(parser_batches_parse_as_documents_alone)
+{
+    for(int mode : { Parser::OPTION_NONE, Parser::OPTION_MULTI_PATTERN, Parser::OPTION_TOKEN_STREAM }) {
+        Parser parser(test::path("grammars/arithmetic.peg"), mode);
+        auto batch = parser.parseBatch(arithmetic);
+        CHECK(batch.size() == arithmetic.size());
+        for(unsigned long i = 0; i < batch.size(); i++) {
+            CHECK(format(batch[i]) == parse(parser, arithmetic[i]));
+        }
+    }
+}
+
+SAGE_TEST(parser_contexts_are_reused_between_parsers)
+{
+    Parser arithmetic_parser(test::path("grammars/arithmetic.peg"), Parser::OPTION_MULTI_PATTERN);
+    Parser palindrome(test::path("grammars/palindrome.peg"));
+    ParseContext context;
+
+    for(auto& input : arithmetic) {
+        CHECK(format(arithmetic_parser.parse(context, input)) == parse(arithmetic_parser, input));
+        CHECK(format(palindrome.parse(context, "a b a")) == parse(palindrome, "a b a"));
+    }
+
+    // An abandoned parse leaves the context usable
+    ParseOptions options;
+    options.max_steps = 5;
+    CHECK_THROWS(arithmetic_parser.parse(context, arithmetic[0], options), ParseAborted);
+    CHECK(format(arithmetic_parser.parse(context, arithmetic[1])) == parse(arithmetic_parser, arithmetic[1]));
+}
+
+/**
+ * Flattening
+ * ================================
+ */
+namespace
+{
+    // The tokens of the tree's terminals in order, and whether the tree is flat (i.e. has
+    // neither empty nodes nor branches nested directly within branches)
+    std::string tokens(const AST& ast, bool& flat)
+    {
+        std::string joined;
+        flat = true;
+        std::vector<const AST*> parents = { nullptr };
+        for(auto it = ast.preorder().begin(); it != AST::Iterator(); ++it) {
+            parents.resize(it.getDepth() + 1);
+            auto parent = parents.back();
+            if(it->getTag() == AST::EMPTY) {
+                flat = false;
+            } else if(it->getTag() == AST::BRANCHES && parent && parent->getTag() == AST::BRANCHES) {
+                flat = false;
+            } else if(it->getTag() == AST::TERMINAL) {
+                joined += it->getToken() + " ";
+            }
+            parents.push_back(&*it);
+        }
+        return joined;
+    }
+}
+
+SAGE_TEST(parser_flattens_trees)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    ParseOptions flatten;
+    flatten.flatten = true;
+
+    for(auto& input : arithmetic) {
+        std::stringstream nested_input(input), flat_input(input);
+        auto nested = parser.parse(nested_input);
+        auto flattened = parser.parse(flat_input, flatten);
+        CHECK(!nested == !flattened);
+        if(nested && flattened) {
+            bool nested_flat = false, flattened_flat = false;
+            CHECK(tokens(*nested, nested_flat) == tokens(*flattened, flattened_flat));
+            CHECK(!nested_flat && flattened_flat);
+        }
+    }
+}
+
+SAGE_TEST(parser_shapes_annotated_rules)
+{
+    Parser parser(test::path("tests/grammars/annotated.peg"));
+    ParseOptions flatten;
+    flatten.flatten = true;
+
+    // Annotations only apply to flattened trees, in which even the start rule may be inlined
+    CHECK(parse(parser, "7") != parse(parser, "7", flatten));
+    CHECK(parse(parser, "7", flatten) == "|- 7\n");
+    CHECK(parse(parser, "1 + (2 * 3)", flatten) ==
+        "|- Sum\n"
+        "|---------- 1\n"
+        "|---------- +\n"
+        "|---------- Product\n"
+        "|-------------------- (\n"
+        "|-------------------- Expression\n"
+        "|------------------------- Product\n"
+        "|----------------------------------- 2\n"
+        "|----------------------------------- *\n"
+        "|----------------------------------- 3\n"
+        "|-------------------- )\n");
+
+    ParseOptions sharing = flatten;
+    sharing.share_nodes = true;
+    for(auto& input : arithmetic) {
+        CHECK(parse(parser, input, sharing) == parse(parser, input, flatten));
+    }
+    CHECK_THROWS(Parser(test::path("tests/grammars/undefined.peg")), InvalidGrammar);
+}
+
+SAGE_TEST(parser_joins_the_tokens_of_leaves)
+{
+    Parser parser(test::path("tests/grammars/leaf.peg"));
+    ParseOptions flatten;
+    flatten.flatten = true;
+
+    std::stringstream input("ab 12 x cd 3");
+    auto ast = parser.parse(input, flatten);
+    CHECK(format(ast) == "|----- Pair\n|---------- ab12\n|----- Opt\n|---------- x\n|----- Pair\n|---------- cd3\n");
+
+    // A leaf matching nothing spans where it was attempted
+    std::stringstream empty("ab 12 cd 3");
+    ast = parser.parse(empty, flatten);
+    CHECK(ast != nullptr);
+    if(!ast) {
+        return;
+    }
+    unsigned long leaves = 0;
+    for(auto& node : ast->preorder()) {
+        if(node.getTag() == AST::NONTERMINAL && node.getType() == "Opt") {
+            leaves++;
+            CHECK(node.getStart() == 6 && node.getEnd() == 6);
+            CHECK(node.getChild(0)->getToken().empty() && node.getChild(0)->getStart() == 6);
+        }
+    }
+    CHECK(leaves == 1);
+}
+
+/**
+ * Budgets
+ * ================================
+ */
+namespace
+{
+    // The reason the given parse was abandoned, or -1 if it was not
+    int aborted(Parser& parser, const std::string& input, const ParseOptions& options)
+    {
+        try {
+            parse(parser, input, options);
+        } catch(ParseAborted& e) {
+            return e.getReason();
+        }
+        return -1;
+    }
+}
+
+SAGE_TEST(parser_aborts_past_its_budget)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    ParseOptions options;
+    CHECK(aborted(parser, arithmetic[0], options) == -1);
+
+    options.max_steps = 10;
+    CHECK(aborted(parser, arithmetic[0], options) == ParseAborted::ABORT_STEPS);
+    try {
+        parse(parser, arithmetic[0], options);
+    } catch(ParseAborted& e) {
+        CHECK(e.getSteps() == options.max_steps + 1);
+    }
+    options.max_steps = 100000;
+    CHECK(aborted(parser, arithmetic[0], options) == -1);
+
+    ParseOptions memory;
+    memory.max_memory = 1;
+    CHECK(aborted(parser, arithmetic[0], memory) == ParseAborted::ABORT_MEMORY);
+
+    ParseOptions deadline;
+    deadline.setTimeout(std::chrono::milliseconds(0));
+    CHECK(aborted(parser, arithmetic[0], deadline) == ParseAborted::ABORT_DEADLINE);
+}
+
+SAGE_TEST(parser_aborts_once_cancelled)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    ParseOptions options;
+    options.cancel = std::make_shared<std::atomic<bool>>(false);
+    CHECK(aborted(parser, arithmetic[0], options) == -1);
+    options.cancel->store(true);
+    CHECK(aborted(parser, arithmetic[0], options) == ParseAborted::ABORT_CANCELLED);
+}
+
+SAGE_TEST(parser_stops_repetitions_consuming_nothing)
+{
+    // No limits are set, so a repetition which did not stop would never return
+    Parser parser(test::path("tests/grammars/empty.peg"));
+    CHECK(!parse(parser, "y").empty());
+    CHECK(!parse(parser, "x x z y").empty());
+    CHECK(!parse(parser, "z z z y").empty());
+    CHECK(parse(parser, "x z x y").empty());
+    CHECK(parse(parser, "x").empty());
+}
+
+/**
+ * Sharing
+ * ================================
+ */
+SAGE_TEST(parser_shares_nodes_of_rules_parsed_again)
+{
+    Parser parser(test::path("tests/grammars/prefix.peg"));
+    ParseOptions sharing;
+    sharing.share_nodes = true;
+
+    const std::string input = std::string(8, '(') + "x" + std::string(8, ')');
+    auto plain = parse(parser, input);
+    auto plain_counters = parser.getCounters();
+    CHECK(!plain.empty() && plain_counters.shared_nodes == 0);
+
+    CHECK(parse(parser, input, sharing) == plain);
+    CHECK(parser.getCounters().shared_nodes > 0);
+    CHECK(parser.getCounters().regex.transitions * 10 < plain_counters.regex.transitions);
+
+    CHECK(parse(parser, "((x)?)", sharing) == parse(parser, "((x)?)"));
+    CHECK(parse(parser, "((x)", sharing).empty());
+}
+
+SAGE_TEST(parser_records_the_span_of_nodes)
+{
+    Parser parser(test::path("tests/grammars/prefix.peg"));
+    std::stringstream input("((x)?)");
+    auto ast = parser.parse(input);
+    CHECK(ast != nullptr);
+    if(!ast) {
+        return;
+    }
+
+    // Each Term spans its own parentheses
+    CHECK(ast->getStart() == 0 && ast->getEnd() == 6);
+    using span = std::pair<long, long>;
+    std::vector<span> terms;
+    for(auto& node : ast->preorder()) {
+        if(node.getTag() == AST::NONTERMINAL && node.getType() == "Term") {
+            terms.emplace_back(node.getStart(), node.getEnd());
+            CHECK(node.getRule() != Tracer::NO_RULE);
+        } else if(node.getTag() == AST::TERMINAL && node.getToken() == "x") {
+            CHECK(node.getStart() == 2 && node.getEnd() == 3);
+        }
+    }
+    CHECK(terms == std::vector<span>({ span(0, 6), span(1, 5), span(2, 3) }));
+}
+
+/**
+ * Counters
+ * ================================
+ */
+SAGE_TEST(scanner_counts_reads_and_checkpoints)
+{
+    std::stringstream input("abc def");
+    Scanner scanner(input);
+    auto mark = scanner.saveCheckpoint();
+    CHECK(scanner.nextWord() == "abc");
+    scanner.restoreCheckpoint(mark);
+    CHECK(scanner.nextWord() == "abc" && scanner.nextWord() == "def");
+
+    auto& counters = scanner.getCounters();
+    CHECK(counters.saves == 1 && counters.restores == 1);
+    CHECK(counters.bytes_read >= input.str().size());
+
+    scanner.resetCounters();
+    CHECK(scanner.getCounters().bytes_read == 0 && scanner.getCounters().saves == 0);
+}
+
+SAGE_TEST(parser_counts_the_latest_parse)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    CHECK(!parse(parser, arithmetic[0]).empty());
+    auto first = parser.getCounters();
+    CHECK(first.scanner.bytes_read >= arithmetic[0].size());
+    CHECK(first.scanner.restores > 0);
+    CHECK(first.regex.transitions > 0);
+
+    // Counters are those of the most recent parse alone
+    CHECK(!parse(parser, "1").empty());
+    CHECK(parser.getCounters().scanner.bytes_read < first.scanner.bytes_read);
+    CHECK(parser.getCounters().regex.transitions < first.regex.transitions);
+}
+
+/**
+ * Profiling
+ * ================================
+ */
+SAGE_TEST(profiler_records_rules_of_the_attached_thread)
+{
+    Profiler profiler;
+    std::stringstream input("12");
+    Scanner scanner(input);
+
+    // Rules are only recorded while a profiler is attached
+    Profiler::Rule(std::string("Ignored"), scanner).succeed();
+    {
+        Profiler::Attachment attachment(profiler);
+        Profiler::Rule start("Start", scanner);
+        {
+            Profiler::Rule digit("Digit", scanner);
+            scanner.read();
+            digit.succeed();
+        }
+        {
+            Profiler::Rule digit("Digit", scanner);
+            Profiler::restore();
+        }
+        start.succeed();
+    }
+    Profiler::Rule(std::string("Ignored"), scanner).succeed();
+
+    auto& statistics = profiler.getStatistics();
+    CHECK(statistics.size() == 2 && statistics.count("Ignored") == 0);
+    auto& digit = statistics.at("Digit");
+    CHECK(digit.invocations == 2 && digit.successes == 1 && digit.failures == 1);
+    CHECK(digit.restores == 1 && digit.bytes == 1);
+    auto& start = statistics.at("Start");
+    CHECK(start.invocations == 1 && start.successes == 1 && start.restores == 0 && start.bytes == 1);
+    CHECK(start.inclusive_ns >= digit.inclusive_ns);
+
+    std::stringstream report, collapsed;
+    profiler.report(report);
+    profiler.collapsed(collapsed);
+    CHECK(report.str().find("Digit\t2\t1\t1\t1\t1\t") != std::string::npos);
+    CHECK(collapsed.str().find("Start ") == 0);
+    CHECK(collapsed.str().find("\nStart;Digit ") != std::string::npos);
+
+    profiler.reset();
+    CHECK(profiler.getStatistics().empty());
+}
+
+/**
+ * Tracing
+ * ================================
+ */
+SAGE_TEST(tracer_keeps_the_latest_events)
+{
+    Tracer tracer;
+    std::stringstream input("12");
+    Scanner scanner(input);
+    CHECK(!tracer.isEnabled());
+    {
+        // Attaching a disabled tracer records nothing
+        Tracer::Attachment attachment(tracer);
+        Tracer::Rule(0, scanner).succeed();
+    }
+
+    tracer.enable(3);
+    CHECK(tracer.isEnabled());
+    tracer.setRules({ "Start", "Digit" });
+    {
+        Tracer::Attachment attachment(tracer);
+        Tracer::Rule start(0, scanner);
+        {
+            Tracer::Rule digit(1, scanner);
+            scanner.read();
+            digit.succeed();
+        }
+        Tracer::restore(scanner);
+        start.succeed();
+    }
+
+    auto contents = dump(tracer);
+    unsigned long offset = 8;
+    CHECK(contents.compare(0, offset, TRACER_MAGIC) == 0);
+    CHECK(read<std::uint32_t>(contents, offset) == 2);
+    CHECK(read<std::uint16_t>(contents, offset) == 5 && contents.compare(offset, 5, "Start") == 0);
+    offset += 5;
+    CHECK(read<std::uint16_t>(contents, offset) == 5 && contents.compare(offset, 5, "Digit") == 0);
+    offset += 5;
+
+    // Five events were recorded, of which the buffer (rounded up to four slots) keeps the last
+    CHECK(read<std::uint64_t>(contents, offset) == 4);
+    CHECK(contents.size() == offset + 4 * sizeof(Tracer::Event));
+    std::vector<Tracer::Event> events;
+    while(offset < contents.size()) {
+        events.push_back(read<Tracer::Event>(contents, offset));
+    }
+    const std::uint8_t types[] = { Tracer::EVENT_ENTER, Tracer::EVENT_SUCCEED, Tracer::EVENT_RESTORE, Tracer::EVENT_SUCCEED };
+    const std::uint16_t rules[] = { 1, 1, 0, 0 };
+    const std::uint32_t offsets[] = { 0, 1, 1, 1 };
+    for(unsigned long i = 0; i < events.size(); i++) {
+        CHECK(events[i].type == types[i] && events[i].rule == rules[i] && events[i].offset == offsets[i]);
+        CHECK(i == 0 || events[i - 1].timestamp <= events[i].timestamp);
+    }
+
+    tracer.disable();
+    CHECK(!tracer.isEnabled());
+}
+
+SAGE_TEST(parser_traces_once_enabled)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    CHECK(!parse(parser, arithmetic[0]).empty());
+    auto disabled = dump(parser.getTracer());
+    CHECK(disabled.compare(0, 8, TRACER_MAGIC) == 0);
+
+    parser.getTracer().enable(1 << 16);
+    CHECK(!parse(parser, arithmetic[0]).empty());
+    auto contents = dump(parser.getTracer());
+    CHECK(contents.size() > disabled.size());
+
+    // The rules are named alike either way, so the count of events sits at the same offset
+    unsigned long header = disabled.size() - sizeof(std::uint64_t), offset = header;
+    CHECK(read<std::uint64_t>(disabled, offset) == 0);
+    CHECK(contents.compare(0, header, disabled, 0, header) == 0);
+    offset = header;
+    auto count = read<std::uint64_t>(contents, offset);
+    CHECK(count > 0 && contents.size() == offset + count * sizeof(Tracer::Event));
+
+    // The parse ends with the start rule succeeding at the end of the input
+    offset = contents.size() - sizeof(Tracer::Event);
+    auto last = read<Tracer::Event>(contents, offset);
+    CHECK(last.type == Tracer::EVENT_SUCCEED);
+    CHECK(last.offset == arithmetic[0].size());
+}
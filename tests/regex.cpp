@@ -0,0 +1,410 @@
+/**
+ * regex.cpp
+ *
+ * Tests of the Regex module: single expressions, sets of expressions and the compile cache.
+ */
+
+#include <thread>
+
+#include "Regex/RegexSet.h"
+#include "utf8.h"
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * Repetition
+ * ================================
+ */
+SAGE_TEST(regex_repetition_counts)
+{
+    Regex exact("a{3}");
+    CHECK(exact.matches("aaa"));
+    CHECK(!exact.matches("aa") && !exact.matches("aaaa"));
+
+    Regex least("a{2,}");
+    CHECK(!least.matches("a"));
+    CHECK(least.matches("aa") && least.matches("aaaaaaaa"));
+
+    Regex between("(ab){1,3}");
+    CHECK(!between.matches(""));
+    CHECK(between.matches("ab") && between.matches("ababab"));
+    CHECK(!between.matches("abababab"));
+
+    Regex none("a{0}b");
+    CHECK(none.matches("b") && !none.matches("ab"));
+}
+
+SAGE_TEST(regex_repetition_stacks)
+{
+    Regex stacked("a{2}{3}");
+    CHECK(stacked.matches("aaaaaa"));
+    CHECK(!stacked.matches("aa{3}") && !stacked.matches("aaaaa"));
+
+    Regex ranged("a{1,2}{2}");
+    CHECK(!ranged.matches("a"));
+    CHECK(ranged.matches("aa") && ranged.matches("aaa") && ranged.matches("aaaa"));
+}
+
+SAGE_TEST(regex_repetition_without_count_is_literal)
+{
+    Regex literal("a{x}");
+    CHECK(literal.matches("a{x}"));
+    Regex trailing("a{2}{x}");
+    CHECK(trailing.matches("aa{x}"));
+}
+
+SAGE_TEST(regex_repetition_rejects_invalid_bounds)
+{
+    CHECK_THROWS(Regex("a{3,2}"), InvalidRegex);
+    CHECK_THROWS(Regex("a{2"), InvalidRegex);
+    CHECK_THROWS(Regex("a{2,3x}"), InvalidRegex);
+    CHECK_THROWS(Regex("a{99999999999999999999999}"), InvalidRegex);
+    CHECK_THROWS(Regex("a{1,99999999999999999999999}"), InvalidRegex);
+}
+
+SAGE_TEST(regex_repetition_respects_state_limit)
+{
+    Regex::setStateLimit(50);
+    CHECK_THROWS(Regex("b{1,200}"), InvalidRegex);
+    CHECK_THROWS(Regex("b{200,}"), InvalidRegex);
+    CHECK_THROWS(Regex("(bc){18446744073709551615}"), InvalidRegex);
+    CHECK(Regex("b{1,5}").matches("bbb"));
+    Regex::setStateLimit(REGEX_STATE_LIMIT);
+    CHECK(Regex("b{1,200}").matches("bbb"));
+}
+
+/**
+ * Bytes and Code Points
+ * ================================
+ */
+namespace
+{
+    // Whether the encoding of the given code point matches exactly one of the sequences
+    bool matchesOnce(const std::vector<utf8_sequence>& sequences, unsigned long code)
+    {
+        std::string bytes = utf8_encode(code);
+        int matched = 0;
+        for(auto& sequence : sequences) {
+            bool within = sequence.size() == bytes.size();
+            for(unsigned long i = 0; within && i < bytes.size(); i++) {
+                auto byte = static_cast<unsigned char>(bytes[i]);
+                within = sequence[i].first <= byte && byte <= sequence[i].second;
+            }
+            matched += within ? 1 : 0;
+        }
+        return matched == 1;
+    }
+}
+
+SAGE_TEST(regex_bytes_span_eight_bits)
+{
+    Regex wildcard(".");
+    CHECK(wildcard.matches("\x80") && wildcard.matches("\xff"));
+    CHECK(!wildcard.matches("\xce\xb2"));
+
+    Regex high("[\x80-\xff]+");
+    CHECK(high.matches("\xce\xb2\xff"));
+    CHECK(!high.matches("a"));
+}
+
+SAGE_TEST(regex_utf8_refers_to_code_points)
+{
+    Regex greek("[\xce\xb1-\xcf\x89]+", Regex::FLAG_UTF8);
+    CHECK(greek.matches("\xce\xb2\xce\xbb"));
+    CHECK(!greek.matches("a") && !greek.matches("\xce"));
+
+    Regex wildcard(".", Regex::FLAG_UTF8);
+    CHECK(wildcard.matches("a") && wildcard.matches("\xe2\x82\xac"));
+    CHECK(wildcard.matches("\xf0\x9f\x98\x80"));
+    CHECK(!wildcard.matches("\xe2\x82") && !wildcard.matches("\xe2\x82\xac!"));
+
+    Regex literal("\xe2\x82\xac?5", Regex::FLAG_UTF8);
+    CHECK(literal.matches("5") && literal.matches("\xe2\x82\xac" "5"));
+}
+
+SAGE_TEST(regex_utf8_ranges_cover_each_code_point_once)
+{
+    std::vector<utf8_sequence> sequences;
+    utf8_ranges(0x61, 0x10FFFF, sequences);
+    for(unsigned long code : { 0x61UL, 0x7FUL, 0x80UL, 0x7FFUL, 0x800UL, 0xD7FFUL, 0xE000UL, 0xFFFFUL, 0x10000UL, 0x10FFFFUL }) {
+        CHECK(matchesOnce(sequences, code));
+    }
+    CHECK(!matchesOnce(sequences, 0x60));
+    CHECK(!matchesOnce(sequences, 0xD800) && !matchesOnce(sequences, 0xDFFF));
+
+    sequences.clear();
+    utf8_ranges(0x3B1, 0x3C9, sequences);
+    for(unsigned long code = 0x380; code < 0x400; code++) {
+        CHECK(matchesOnce(sequences, code) == (0x3B1 <= code && code <= 0x3C9));
+    }
+}
+
+/**
+ * Automata
+ * ================================
+ */
+SAGE_TEST(regex_automaton_traverses_by_index)
+{
+    // (ab)*c built by hand, so that copies of the NFA are also exercised
+    auto ab = std::make_shared<NFA>('a');
+    ab->concatenate(std::make_shared<NFA>('b'));
+    ab->kleeneStar();
+    auto nfa = std::make_shared<NFA>(*ab);
+    nfa->concatenate(std::make_shared<NFA>('c'));
+    DFA dfa(nfa);
+
+    auto walk = [&dfa](const std::string& input) {
+        auto node = dfa.getStart();
+        for(char c : input) {
+            if(!dfa.traverse(node, static_cast<unsigned char>(c))) {
+                return false;
+            }
+        }
+        return dfa.final(node);
+    };
+    CHECK(walk("c") && walk("abc") && walk("ababc"));
+    CHECK(!walk("") && !walk("ab") && !walk("abac"));
+
+    // Traversing by index leaves the cursor of the DFA alone
+    dfa.reset();
+    CHECK(dfa.traverse('a'));
+    CHECK(walk("abc"));
+    CHECK(dfa.traverse('b') && dfa.traverse('c') && dfa.final());
+
+    DFA copy(dfa);
+    copy.reset();
+    CHECK(copy.size() == dfa.size());
+    CHECK(copy.traverse('c') && copy.final());
+}
+
+SAGE_TEST(regex_copies_match_alike)
+{
+    Regex original("[a-c]+x?");
+    Regex copy(original);
+    CHECK(copy.matches("abcx") && !copy.matches("x"));
+
+    Regex moved(std::move(copy));
+    CHECK(moved.matches("cab") && !moved.matches("d"));
+
+    Regex assigned;
+    assigned = moved;
+    CHECK(assigned.matches("ax") && original.matches("ax"));
+}
+
+/**
+ * Counters
+ * ================================
+ */
+SAGE_TEST(regex_counts_transitions_taken)
+{
+    Regex expression("ab+c");
+    auto before = Regex::getCounters();
+    CHECK(expression.matches("abbbc"));
+    CHECK(!expression.matches("abxc"));
+    CHECK((Regex::getCounters() - before).transitions == 5 + 2);
+
+    RegexSet set;
+    set.add(Regex("[a-z]+"));
+    set.compile();
+    before = Regex::getCounters();
+    std::vector<unsigned long> lengths;
+    set.matches("abc1", true, lengths);
+    CHECK((Regex::getCounters() - before).transitions == 3);
+
+    Regex::resetCounters();
+    CHECK(Regex::getCounters().transitions == 0);
+}
+
+/**
+ * Compile Cache
+ * ================================
+ */
+namespace
+{
+    // A program accepting the given byte, compiled under the given state limit
+    std::shared_ptr<const RegexCache::Program> program(char c, unsigned long limit)
+    {
+        auto compiled = std::make_shared<RegexCache::Program>();
+        compiled->automaton = std::make_shared<const DFA>(std::make_shared<NFA>(c));
+        compiled->front_word_bounded = false;
+        compiled->back_word_bounded = false;
+        compiled->limit = limit;
+        return compiled;
+    }
+}
+
+SAGE_TEST(regex_cache_finds_programs_valid_under_the_limit)
+{
+    RegexCache cache;
+    CHECK(cache.find("a", Regex::FLAG_NONE, 100) == nullptr);
+
+    auto a = program('a', 50);
+    CHECK(cache.insert("a", Regex::FLAG_NONE, a) == a);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 100) == a);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 50) == a);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 49) == nullptr);
+    CHECK(cache.find("a", Regex::FLAG_UTF8, 100) == nullptr);
+
+    // Programs compiled under smaller limits replace those under larger ones, and not otherwise
+    CHECK(cache.insert("a", Regex::FLAG_NONE, program('a', 60)) == a);
+    auto smaller = program('a', 10);
+    CHECK(cache.insert("a", Regex::FLAG_NONE, smaller) == smaller);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 10) == smaller);
+
+    auto statistics = cache.getStatistics();
+    CHECK(statistics.hits == 3 && statistics.misses == 3);
+    CHECK(statistics.entries == 1 && statistics.evictions == 0);
+
+    cache.clear();
+    CHECK(cache.getStatistics().entries == 0 && cache.getStatistics().bytes == 0);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 100) == nullptr);
+}
+
+SAGE_TEST(regex_cache_evicts_the_least_recently_used)
+{
+    RegexCache cache;
+    cache.insert("a", Regex::FLAG_NONE, program('a', 100));
+    auto bytes = cache.getStatistics().bytes;
+    cache.insert("b", Regex::FLAG_NONE, program('b', 100));
+    cache.setBudget(2 * bytes);
+    CHECK(cache.getStatistics().entries == 2);
+
+    CHECK(cache.find("a", Regex::FLAG_NONE, 100) != nullptr);
+    cache.insert("c", Regex::FLAG_NONE, program('c', 100));
+    auto statistics = cache.getStatistics();
+    CHECK(statistics.entries == 2 && statistics.evictions == 1 && statistics.bytes <= 2 * bytes);
+    CHECK(cache.find("b", Regex::FLAG_NONE, 100) == nullptr);
+    CHECK(cache.find("a", Regex::FLAG_NONE, 100) != nullptr);
+    CHECK(cache.find("c", Regex::FLAG_NONE, 100) != nullptr);
+
+    // The most recently used program is kept even if over budget
+    cache.setBudget(0);
+    CHECK(cache.getStatistics().entries == 1);
+    CHECK(cache.find("c", Regex::FLAG_NONE, 100) != nullptr);
+}
+
+SAGE_TEST(regex_cache_agrees_with_regex_counters)
+{
+    auto& cache = RegexCache::global();
+    auto counted = Regex::getCounters();
+    auto cached = cache.getStatistics();
+
+    Regex first("cache[0-9]+test");
+    Regex second("cache[0-9]+test");
+    CHECK(first.matches("cache1test") && second.matches("cache42test"));
+
+    // A program compiled under a larger limit is not valid under a smaller one
+    Regex::setStateLimit(1000);
+    Regex third("cache[0-9]+test");
+    Regex::setStateLimit(REGEX_STATE_LIMIT);
+
+    auto regex = Regex::getCounters() - counted;
+    auto statistics = cache.getStatistics();
+    CHECK(regex.cache_hits == 1 && regex.cache_misses == 2);
+    CHECK(statistics.hits - cached.hits == regex.cache_hits);
+    CHECK(statistics.misses - cached.misses == regex.cache_misses);
+    CHECK(regex.constructions == 2);
+}
+
+/**
+ * Regex Sets
+ * ================================
+ */
+SAGE_TEST(regex_set_matches_every_expression)
+{
+    RegexSet set;
+    auto digits = set.add(Regex("[0-9]+"));
+    auto word = set.add(Regex("[a-z]+"));
+    auto hex = set.add(Regex("0x[0-9a-f]+"));
+    CHECK(set.add(Regex("[0-9]+")) == digits);
+    CHECK(set.size() == 3);
+
+    std::vector<unsigned long> lengths;
+    set.matches("0x1f", true, lengths);
+    CHECK(lengths.size() == 3);
+    CHECK(lengths[digits] == 1);
+    CHECK(lengths[word] == 0);
+    CHECK(lengths[hex] == 4);
+
+    set.matches("abc1", true, lengths);
+    CHECK(lengths[digits] == 0);
+    CHECK(lengths[word] == 3);
+}
+
+SAGE_TEST(regex_set_longest_reports_accepting_expressions)
+{
+    RegexSet set;
+    auto keyword = set.add(Regex("if"));
+    auto word = set.add(Regex("[a-z]+"));
+
+    const std::vector<unsigned int>* accepted = nullptr;
+    CHECK(set.longest("x if", 2, accepted) == 2);
+    CHECK(accepted != nullptr && accepted->size() == 2);
+    CHECK(set.longest("iffy", 0, accepted) == 4);
+    CHECK(accepted->size() == 1 && (*accepted)[0] == word);
+    CHECK(set.longest("1", 0, accepted) == 0);
+    (void) keyword;
+}
+
+SAGE_TEST(regex_set_recompiles_once_expanded)
+{
+    RegexSet set;
+    set.add(Regex("a"));
+    set.compile();
+    CHECK(set.isCompiled());
+
+    auto b = set.add(Regex("b"));
+    CHECK(!set.isCompiled());
+
+    std::vector<unsigned long> lengths;
+    set.matches("b", true, lengths);
+    CHECK(set.isCompiled());
+    CHECK(lengths[b] == 1);
+}
+
+SAGE_TEST(regex_set_respects_word_boundaries)
+{
+    RegexSet set;
+    auto bounded = set.add(Regex("\\bab"));
+    auto unbounded = set.add(Regex("ab"));
+
+    std::vector<unsigned long> lengths;
+    set.matches("ab", false, lengths);
+    CHECK(lengths[bounded] == 0);
+    CHECK(lengths[unbounded] == 2);
+    set.matches("ab", true, lengths);
+    CHECK(lengths[bounded] == 2);
+}
+
+SAGE_TEST(regex_set_matches_from_many_threads)
+{
+    RegexSet set;
+    set.add(Regex("[a-z]+"));
+    set.add(Regex("[a-z]+[0-9]"));
+    set.compile();
+
+    // Each thread holds its own cursor, so none sees another's progress through the automaton
+    const std::vector<std::string> inputs = { "abc1", "xyz", "q9", "12" };
+    std::vector<unsigned long> mismatches(inputs.size(), 0);
+    std::vector<std::thread> threads;
+    for(unsigned long t = 0; t < inputs.size(); t++) {
+        threads.emplace_back([&set, &inputs, &mismatches, t]() {
+            std::vector<unsigned long> lengths;
+            const std::vector<unsigned int>* accepted = nullptr;
+            for(int i = 0; i < 2000; i++) {
+                set.matches(inputs[t], false, lengths);
+                auto longest = set.longest(inputs[t], 0, accepted);
+                auto expected = (t < 3) ? inputs[t].size() : 0;
+                if(longest != expected || std::max(lengths[0], lengths[1]) != expected) {
+                    mismatches[t]++;
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(mismatches == std::vector<unsigned long>(inputs.size(), 0));
+}
@@ -0,0 +1,356 @@
+/**
+ * scanner.cpp
+ *
+ * Tests of the Scanner and the sources of input it reads from.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+#include "Parser/Inflate.h"
+#include "Parser/LineIndex.h"
+#include "Parser/Parser.h"
+#include "Parser/ReadAhead.h"
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * Checkpoints
+ * ================================
+ */
+SAGE_TEST(scanner_restores_nested_checkpoints)
+{
+    std::stringstream input("one two three four");
+    Scanner scanner(input);
+
+    scanner.saveCheckpoint();
+    CHECK(scanner.nextWord() == "one");
+    auto second = scanner.saveCheckpoint();
+    CHECK(scanner.nextWord() == "two");
+    scanner.saveCheckpoint();
+    CHECK(scanner.nextWord() == "three");
+
+    // Restoring a checkpoint discards all those saved after it
+    scanner.restoreCheckpoint(second);
+    CHECK(scanner.nextWord() == "two");
+    scanner.restoreCheckpoint();
+    CHECK(scanner.nextWord() == "one" && scanner.nextWord() == "two");
+
+    // Releasing a checkpoint keeps the position
+    scanner.saveCheckpoint();
+    scanner.saveCheckpoint();
+    CHECK(scanner.nextWord() == "three");
+    scanner.releaseCheckpoint();
+    scanner.restoreCheckpoint();
+    CHECK(scanner.nextWord() == "three" && scanner.nextWord() == "four");
+    CHECK(!scanner.hasNext());
+}
+
+SAGE_TEST(scanner_advances_to_earlier_marks)
+{
+    std::stringstream input("alpha beta gamma");
+    Scanner scanner(input);
+    auto begin = scanner.getMark();
+    CHECK(scanner.nextWord() == "alpha" && scanner.nextWord() == "beta");
+    auto end = scanner.getMark();
+
+    // Delimiters following a token are skipped along with it
+    CHECK(scanner.getPosition() == 11);
+
+    scanner.advanceTo(begin);
+    CHECK(scanner.getPosition() == 0 && scanner.nextWord() == "alpha");
+    scanner.advanceTo(end);
+    CHECK(scanner.nextWord() == "gamma");
+}
+
+SAGE_TEST(scanner_checkpoints_tokens)
+{
+    auto set = std::make_shared<RegexSet>();
+    auto word = set->add(Regex("[a-z]+"));
+    auto number = set->add(Regex("[0-9]+"));
+
+    std::stringstream input("abc 12 de");
+    Scanner scanner(input, std::make_shared<Lexer>(set));
+    auto mark = scanner.saveCheckpoint();
+    CHECK(scanner.next(*set, word) == "abc" && scanner.next(*set, number) == "12");
+    CHECK(scanner.getPosition() == 7);
+    scanner.restoreCheckpoint(mark);
+    CHECK(scanner.getPosition() == 0);
+    CHECK(!scanner.hasNext(*set, number) && scanner.hasNext(*set, word));
+}
+
+/**
+ * Lines
+ * ================================
+ */
+namespace
+{
+    // Whether the given state lies at the given line and column
+    bool at(const ScanState& state, unsigned int line, unsigned int column)
+    {
+        return state.getLine() == line && state.getColumn() == column;
+    }
+}
+
+SAGE_TEST(line_index_locates_offsets)
+{
+    LineIndex lines;
+    lines.append("ab\ncd", 5);
+    lines.append("\n\nef", 4);
+
+    CHECK(at(lines.locate(0), 1, 1) && at(lines.locate(2), 1, 3));
+    CHECK(at(lines.locate(3), 2, 1) && at(lines.locate(5), 2, 3));
+    CHECK(at(lines.locate(6), 3, 1) && at(lines.locate(8), 4, 2));
+    CHECK(at(lines.locate(10), 4, 4));
+    CHECK(lines.locate(8).getCursor() == 8);
+
+    // Offsets past the discarded newlines are located as before
+    lines.discard(7);
+    CHECK(at(lines.locate(7), 4, 1) && at(lines.locate(8), 4, 2));
+
+    lines.clear();
+    CHECK(at(lines.locate(1), 1, 2));
+}
+
+SAGE_TEST(scanner_reports_lines_and_columns)
+{
+    std::stringstream input("ab\n  cd ef\n\ngh");
+    Scanner scanner(input);
+    CHECK(at(scanner.getCurrentState(), 1, 1));
+    CHECK(scanner.nextWord() == "ab");
+    CHECK(at(scanner.getCurrentState(), 2, 3));
+    CHECK(scanner.next(Regex("[a-z]+")) == "cd");
+    CHECK(at(scanner.getCurrentState(), 2, 6));
+    CHECK(scanner.nextWord() == "ef");
+    CHECK(at(scanner.getCurrentState(), 4, 1));
+}
+
+/**
+ * Discarding
+ * ================================
+ */
+namespace
+{
+    const Regex word("w[0-9]+");
+
+    // Numbered words, one per line, spanning several chunks of input
+    std::string numbered(unsigned long count)
+    {
+        std::string content;
+        for(unsigned long i = 0; i < count; i++) {
+            content += "w" + std::to_string(i) + "\n";
+        }
+        return content;
+    }
+}
+
+SAGE_TEST(scanner_discards_unreachable_input)
+{
+    const unsigned long count = 100000;
+    std::stringstream input(numbered(count));
+    Scanner scanner(input);
+    for(unsigned long i = 0; i < count; i++) {
+        CHECK(scanner.getCurrentState().getLine() == i + 1);
+        if(scanner.next(word) != "w" + std::to_string(i)) {
+            CHECK(false);
+            break;
+        }
+    }
+    CHECK(!scanner.hasNext());
+    CHECK(scanner.getCounters().bytes_discarded > 0);
+    CHECK(scanner.getCounters().bytes_discarded <= input.str().size());
+}
+
+SAGE_TEST(scanner_keeps_input_reachable_by_checkpoints)
+{
+    const unsigned long count = 100000;
+    std::stringstream input(numbered(count));
+    Scanner scanner(input);
+    scanner.saveCheckpoint();
+    while(scanner.hasNext()) {
+        scanner.next(word);
+    }
+    CHECK(scanner.getCounters().bytes_discarded == 0);
+
+    scanner.restoreCheckpoint();
+    CHECK(scanner.next(word) == "w0" && at(scanner.getCurrentState(), 2, 1));
+}
+
+SAGE_TEST(parser_discards_input_while_parsing)
+{
+    std::string sum = "1";
+    for(int i = 0; i < 40000; i++) {
+        sum += " + " + std::to_string(i);
+    }
+
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    std::stringstream input(sum);
+    CHECK(parser.parse(input) != nullptr);
+    CHECK(parser.getCounters().scanner.bytes_discarded > 0);
+}
+
+/**
+ * Reading Ahead
+ * ================================
+ */
+namespace
+{
+    // A file holding the given content, removed once destroyed
+    class TemporaryFile
+    {
+        public:
+            TemporaryFile(const std::string& content)
+            {
+                char name[] = "/tmp/sage_test_XXXXXX";
+                int fd = mkstemp(name);
+                close(fd);
+                path = name;
+                std::ofstream(path, std::ios::binary) << content;
+            }
+
+            ~TemporaryFile()
+            {
+                std::remove(path.c_str());
+            }
+
+            std::string path;
+    };
+
+    // Everything the given buffer hands out
+    std::string drain(std::streambuf& buffer)
+    {
+        return std::string(std::istreambuf_iterator<char>(&buffer), std::istreambuf_iterator<char>());
+    }
+}
+
+SAGE_TEST(read_ahead_hands_out_the_file)
+{
+    auto content = numbered(5000);
+    TemporaryFile file(content);
+    for(unsigned long chunk : { 7UL, 4096UL, static_cast<unsigned long>(SCANNER_CHUNK_SIZE) }) {
+        ReadAhead buffer(file.path, chunk, 2);
+        CHECK(buffer.is_open());
+        CHECK(drain(buffer) == content);
+    }
+
+    TemporaryFile empty("");
+    ReadAhead nothing(empty.path);
+    CHECK(nothing.is_open() && drain(nothing).empty());
+
+    ReadAhead missing(file.path + ".missing");
+    CHECK(!missing.is_open());
+
+    // Destroying the buffer before the file is read stops the worker
+    ReadAhead partial(file.path, 16, 1);
+    CHECK(partial.sgetc() == 'w');
+}
+
+SAGE_TEST(parser_reads_files_ahead)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    std::string sum = "1";
+    for(int i = 0; i < 40000; i++) {
+        sum += " +\n" + std::to_string(i);
+    }
+    TemporaryFile file(sum);
+
+    std::stringstream input(sum), expected, actual;
+    parser.parse(input)->format(expected);
+    auto ast = parser.parseFile(file.path);
+    CHECK(ast != nullptr);
+    if(ast) {
+        ast->format(actual);
+        CHECK(actual.str() == expected.str());
+    }
+    CHECK_THROWS(parser.parseFile(file.path + ".missing"), InputError);
+}
+
+/**
+ * Decompression
+ * ================================
+ */
+#ifdef SAGE_ZLIB
+
+namespace
+{
+    // Compresses the given content into a single gzip member (or a zlib stream if not gzip)
+    std::string compress(const std::string& content, bool gzip = true)
+    {
+        z_stream stream = z_stream();
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip ? 31 : 15, 8, Z_DEFAULT_STRATEGY);
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(content.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+        stream.avail_in = static_cast<uInt>(content.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return compressed;
+    }
+
+    // The decompressed content of the given input, read in chunks of the given size
+    std::string inflate(const std::string& input, unsigned long chunk)
+    {
+        std::stringbuf source(input);
+        Inflate buffer(source, chunk);
+        return drain(buffer);
+    }
+}
+
+SAGE_TEST(inflate_reads_concatenated_members)
+{
+    auto first = numbered(3000), second = numbered(10);
+    for(unsigned long chunk : { 1UL, 5UL, static_cast<unsigned long>(SCANNER_CHUNK_SIZE) }) {
+        CHECK(inflate(compress(first), chunk) == first);
+        CHECK(inflate(compress(first) + compress(second), chunk) == first + second);
+        CHECK(inflate(compress(first, false), chunk) == first);
+    }
+    CHECK(inflate(compress(""), 5).empty());
+}
+
+SAGE_TEST(inflate_ignores_trailing_garbage)
+{
+    auto content = numbered(100);
+    CHECK(inflate(compress(content) + "garbage", 5) == content);
+    CHECK(inflate(compress(content) + "\x1f", 5) == content);
+}
+
+SAGE_TEST(inflate_rejects_corrupt_input)
+{
+    auto compressed = compress(numbered(1000));
+    CHECK_THROWS(inflate(compressed.substr(0, compressed.size() / 2), 64), InputError);
+    CHECK_THROWS(inflate(compressed.substr(0, 10) + std::string(100, 'x'), 64), InputError);
+}
+
+SAGE_TEST(parser_decompresses_files)
+{
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    std::string content = "195 + (186 * 32)\n - 14 / 9";
+    TemporaryFile file(compress(content));
+    std::stringstream input(content), expected, actual;
+    parser.parse(input)->format(expected);
+    auto ast = parser.parseFile(file.path);
+    CHECK(ast != nullptr);
+    if(ast) {
+        ast->format(actual);
+        CHECK(actual.str() == expected.str());
+    }
+}
+
+#else
+
+SAGE_TEST(parser_rejects_compressed_files)
+{
+    // Without zlib, input beginning with the gzip magic bytes cannot be read
+    Parser parser(test::path("grammars/arithmetic.peg"));
+    TemporaryFile file("\x1f\x8b\x08");
+    CHECK_THROWS(parser.parseFile(file.path), InputError);
+}
+
+#endif //SAGE_ZLIB
@@ -0,0 +1,73 @@
+/**
+ * test.h
+ *
+ * A minimal harness for the checks under /tests. Each test is a function declared with
+ * SAGE_TEST, which registers it to be run by tests/main.cpp. Checks record a failure (with
+ * the file and line of the check) without ending the test, while an exception escaping a
+ * test fails it outright.
+ *
+ * Files (such as grammars) are referred to relative to the root of the repository (see @path),
+ * the grammars written for the tests being kept under tests/grammars.
+ */
+
+#ifndef SAGE_TEST_H
+#define SAGE_TEST_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sage
+{
+    namespace test
+    {
+        // A registered test
+        struct Case
+        {
+            std::string name;
+            std::function<void()> body;
+        };
+
+        // Every registered test, in order of registration
+        std::vector<Case>& cases();
+
+        // Registers a test upon construction (see SAGE_TEST)
+        struct Registration
+        {
+            Registration(const std::string&, std::function<void()>);
+        };
+
+        // Records a failed check within the running test
+        void fail(const char*, int, const std::string&);
+
+        // Path of the given file, relative to the root of the repository
+        std::string path(const std::string&);
+    }
+}
+
+#define SAGE_TEST(name)                                                                     \
+    static void sage_test_##name();                                                         \
+    static sage::test::Registration sage_registration_##name(#name, sage_test_##name);      \
+    static void sage_test_##name()
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if(!(condition)) {                                                                  \
+            sage::test::fail(__FILE__, __LINE__, #condition);                               \
+        }                                                                                   \
+    } while(0)
+
+#define CHECK_THROWS(expression, exception)                                                 \
+    do {                                                                                    \
+        bool sage_thrown = false;                                                           \
+        try {                                                                               \
+            expression;                                                                     \
+        } catch(exception&) {                                                               \
+            sage_thrown = true;                                                             \
+        }                                                                                   \
+        if(!sage_thrown) {                                                                  \
+            sage::test::fail(__FILE__, __LINE__, #expression " throws " #exception);        \
+        }                                                                                   \
+    } while(0)
+
+#endif //SAGE_TEST_H
@@ -0,0 +1,171 @@
+/**
+ * util.cpp
+ *
+ * Tests of the containers under /util.
+ */
+
+#include "interval.h"
+#include "sparse.h"
+
+#include "test.h"
+
+using namespace sage;
+
+/**
+ * Sparse Sets
+ * ================================
+ */
+SAGE_TEST(sparse_set_inserts_each_value_once)
+{
+    SparseSet<> set(10);
+    CHECK(set.empty());
+    CHECK(set.insert(7) && set.insert(2) && set.insert(9));
+    CHECK(!set.insert(2));
+    CHECK(set.size() == 3);
+    CHECK(set.contains(7) && !set.contains(3));
+
+    // Values are kept in order of insertion, so the set doubles as a worklist
+    CHECK(set[0] == 7 && set[1] == 2 && set[2] == 9);
+    std::vector<unsigned int> values(set.begin(), set.end());
+    CHECK(values == std::vector<unsigned int>({ 7, 2, 9 }));
+
+    set.clear();
+    CHECK(set.empty() && !set.contains(7));
+    set.resize(20);
+    CHECK(set.insert(19) && set.contains(19));
+}
+
+/**
+ * Interval Arrays
+ * ================================
+ */
+namespace
+{
+    using tree = IntervalTree<unsigned char, int>;
+
+    // Overlapping intervals sorted by lower bound, valued by their position
+    std::vector<tree::interval> overlapping()
+    {
+        std::vector<tree::interval> intervals;
+        for(int i = 0; i < 40; i++) {
+            int lower = 5 * i;
+            intervals.emplace_back(lower, lower + (i * 7) % 23, i);
+        }
+        return intervals;
+    }
+
+    // The value of the interval containing the given point, or -1 if there is none
+    template<typename T>
+    int lookup(const T& intervals, unsigned char point)
+    {
+        auto it = intervals.find(point, point);
+        return (it == intervals.end()) ? -1 : *it;
+    }
+}
+
+SAGE_TEST(interval_array_finds_as_the_tree_does)
+{
+    // Both inline (few intervals) and heap allocated (many intervals) storage
+    for(int count : { 3, 4, 5, 20 }) {
+        IntervalTree<unsigned char, int> tree;
+        for(int i = count - 1; i >= 0; i--) {
+            tree.insert(10 * i, 10 * i + 5, i);
+        }
+        auto array = tree.freeze();
+        CHECK(array.size() == static_cast<unsigned long>(count));
+
+        for(int point = 0; point < 256; point++) {
+            auto c = static_cast<unsigned char>(point);
+            CHECK(lookup(array, c) == lookup(tree, c));
+        }
+
+        // Intervals are visited in sorted order, as in the tree
+        int expected = 0;
+        for(auto it = array.begin(); it != array.end(); it++, expected++) {
+            CHECK(*it == expected);
+            auto bounds = it.bounds();
+            CHECK(bounds.first == 10 * expected && bounds.second == 10 * expected + 5);
+        }
+        CHECK(expected == count);
+
+        auto copy = array;
+        CHECK(lookup(copy, 10 * (count - 1) + 3) == count - 1);
+        CHECK(lookup(copy, 10 * (count - 1) + 6) == -1);
+    }
+
+    IntervalArray<unsigned char, int> empty;
+    CHECK(empty.find(0, 0) == empty.end());
+}
+
+/**
+ * Bulk Interval Operations
+ * ================================
+ */
+SAGE_TEST(interval_tree_builds_in_bulk)
+{
+    auto intervals = overlapping();
+    tree bulk(intervals), inserted;
+    for(auto& i : intervals) {
+        inserted.insert(std::get<0>(i), std::get<1>(i), std::get<2>(i));
+    }
+
+    auto it = bulk.begin();
+    for(auto& i : intervals) {
+        CHECK(it != bulk.end() && *it == std::get<2>(i));
+        it++;
+    }
+    CHECK(it == bulk.end());
+
+    for(int point = 0; point < 256; point++) {
+        auto c = static_cast<unsigned char>(point);
+        CHECK((lookup(bulk, c) == -1) == (lookup(inserted, c) == -1));
+    }
+    CHECK(tree(std::vector<tree::interval>()).begin() == tree().end());
+}
+
+SAGE_TEST(interval_tree_finds_overlaps)
+{
+    auto intervals = overlapping();
+    tree bulk(intervals);
+    for(auto& query : { std::make_pair(0, 0), std::make_pair(12, 30), std::make_pair(190, 255) }) {
+        std::vector<tree::iterator> found;
+        bulk.overlaps(query.first, query.second, found);
+
+        std::vector<int> expected, values;
+        for(auto& i : intervals) {
+            if(std::get<0>(i) <= query.second && query.first <= std::get<1>(i)) {
+                expected.push_back(std::get<2>(i));
+            }
+        }
+        for(auto& f : found) {
+            values.push_back(*f);
+        }
+        std::sort(values.begin(), values.end());
+        CHECK(values == expected);
+    }
+}
+
+SAGE_TEST(interval_tree_stabs_sorted_points)
+{
+    auto intervals = overlapping();
+    tree bulk(intervals);
+    std::vector<unsigned char> points = { 0, 3, 4, 17, 18, 100, 101, 210, 255 };
+
+    std::vector<std::vector<int>> stabbed, swept;
+    bulk.stab(points, stabbed);
+    tree::stab(intervals, points, swept);
+    CHECK(stabbed.size() == points.size() && swept.size() == points.size());
+
+    for(unsigned long p = 0; p < points.size(); p++) {
+        std::vector<int> expected;
+        for(auto& i : intervals) {
+            if(std::get<0>(i) <= points[p] && points[p] <= std::get<1>(i)) {
+                expected.push_back(std::get<2>(i));
+            }
+        }
+        std::sort(stabbed[p].begin(), stabbed[p].end());
+        std::sort(swept[p].begin(), swept[p].end());
+        CHECK(stabbed[p] == expected);
+        CHECK(swept[p] == expected);
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * tracedecode.cpp
+ *
+ * Prints the events of a dump written by Tracer (see includes/Parser/Tracer.h) in a readable form,
+ * one event per line: the time since tracing was enabled (in microseconds), the offset into the
+ * input, the kind of event, and the rule, indented by how deeply rules were nested at the time.
+ * Since the oldest events of a parse are overwritten, nesting is relative to the shallowest rule
+ * present in the dump.
+ *
+ * Usage: tracedecode FILE
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Parser/Tracer.h"
+
+using namespace sage;
+
+/**
+ * Reading
+ * ================================
+ */
+template<typename T>
+bool readValue(std::istream& in, T& value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool readDump(std::istream& in, std::vector<std::string>& rules, std::vector<Tracer::Event>& events)
+{
+    std::string magic(sizeof(TRACER_MAGIC) - 1, '\0');
+    if(!in.read(&magic[0], magic.size()) || magic != TRACER_MAGIC) {
+        return false;
+    }
+
+    std::uint32_t rule_count;
+    if(!readValue(in, rule_count)) {
+        return false;
+    }
+    for(std::uint32_t i = 0; i < rule_count; i++) {
+        std::uint16_t length;
+        if(!readValue(in, length)) {
+            return false;
+        }
+        std::string name(length, '\0');
+        if(length > 0 && !in.read(&name[0], length)) {
+            return false;
+        }
+        rules.push_back(name);
+    }
+
+    std::uint64_t event_count;
+    if(!readValue(in, event_count)) {
+        return false;
+    }
+    for(std::uint64_t i = 0; i < event_count; i++) {
+        Tracer::Event event;
+        if(!readValue(in, event)) {
+            return false;
+        }
+        events.push_back(event);
+    }
+
+    return true;
+}
+
+/**
+ * Printing
+ * ================================
+ */
+std::string ruleName(const std::vector<std::string>& rules, std::uint16_t rule)
+{
+    return (rule < rules.size()) ? rules[rule] : "?";
+}
+
+const char* eventName(std::uint8_t type)
+{
+    switch(type) {
+        case Tracer::EVENT_ENTER:
+            return "enter";
+        case Tracer::EVENT_SUCCEED:
+            return "succeed";
+        case Tracer::EVENT_FAIL:
+            return "fail";
+        case Tracer::EVENT_RESTORE:
+            return "restore";
+        default:
+            return "?";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if(argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " FILE" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in(argv[1], std::ifstream::binary);
+    std::vector<std::string> rules;
+    std::vector<Tracer::Event> events;
+    if(!in.is_open() || !readDump(in, rules, events)) {
+        std::cerr << "Could not read trace " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Find the shallowest nesting reached, relative to the first event
+    long depth = 0, shallowest = 0;
+    for(auto& event : events) {
+        if(event.type == Tracer::EVENT_ENTER) {
+            depth++;
+        } else if(event.type != Tracer::EVENT_RESTORE) {
+            shallowest = std::min(shallowest, --depth);
+        }
+    }
+
+    std::cout << "# " << rules.size() << " rules, " << events.size() << " events" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    depth = -shallowest;
+    for(auto& event : events) {
+        if(event.type != Tracer::EVENT_ENTER && event.type != Tracer::EVENT_RESTORE) {
+            depth--;
+        }
+        std::cout << std::setw(14) << event.timestamp / 1e3 << ' ' << std::setw(10) << event.offset << ' '
+                  << std::setw(7) << eventName(event.type) << ' ' << std::string(2 * depth, ' ')
+                  << ruleName(rules, event.rule) << '\n';
+        if(event.type == Tracer::EVENT_ENTER) {
+            depth++;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
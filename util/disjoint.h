@@ -9,6 +9,10 @@
  * an iterator. But as it stands, it is not really necessary to be able to start
  * from a node besides the start or end.
  *
+ * Nothing in the library relies on this class anymore: the DFA is built by subset
+ * construction and minimized by partition refinement, neither of which joins sets.
+ * It is thus not specialized for dense integer elements, as there would be no caller.
+ *
  * Created by jrpotter (11/26/2015).
  */
 
@@ -17,17 +17,346 @@
  * 3) A red node cannot have a red child.
  * 4) All root-leaf paths must have the same number of black nodes.
  *
+ * Once no more intervals are to be inserted, the tree can be frozen into an IntervalArray. This
+ * stores the intervals in a sorted contiguous array (inline if small enough) and is searched without
+ * any pointer chasing. Note the frozen form expects disjoint intervals, as is the case for the
+ * edges of a DFA.
+ *
+ * When all intervals are known up front, the tree can instead be built in bulk (from intervals
+ * sorted by lower bound) in linear time. Similarly, a sorted batch of points can be stabbed in a
+ * single sweep of the tree, as opposed to searching once per point.
+ *
  * Created by jrpotter (11/27/2015).
  */
 
 #ifndef SAGE_INTERVAL_H
 #define SAGE_INTERVAL_H
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 namespace sage
 {
+    template<typename K, typename V, typename C=std::less_equal<K>, unsigned int N=4>
+    class IntervalArray {
+
+        public:
+
+            // Iterator
+            // Visits the intervals in sorted order, mirroring that of the IntervalTree
+            class iterator
+            {
+                public:
+                    iterator(const IntervalArray*, unsigned long);
+                    iterator operator++();
+                    iterator operator++(int);
+                    const V& operator*() const;
+                    const V* operator->() const;
+                    const std::pair<K, K> bounds() const;
+                    const bool operator==(const iterator&);
+                    const bool operator!=(const iterator&);
+
+                private:
+                    const IntervalArray* array;
+                    unsigned long index;
+            };
+
+            // Iterator Methods
+            iterator begin() const;
+            iterator end() const;
+
+            // Constructors
+            IntervalArray();
+            IntervalArray(const IntervalArray&);
+            IntervalArray(IntervalArray&&) noexcept;
+            IntervalArray& operator= (IntervalArray);
+            void swap(IntervalArray&, IntervalArray&);
+
+            // Default Operation
+            // Intervals must be appended in sorted order
+            void push_back(K, K, V);
+            iterator find(K, K, C = C()) const;
+            unsigned long size() const;
+
+        private:
+
+            // Up to N intervals are stored inline, after which all are moved to the heap.
+            // Bounds are kept apart from values so searching only touches the lower bounds.
+            unsigned long count;
+            unsigned long capacity;
+            K inline_lower[N];
+            K inline_upper[N];
+            V inline_value[N];
+            std::unique_ptr<K[]> heap_lower;
+            std::unique_ptr<K[]> heap_upper;
+            std::unique_ptr<V[]> heap_value;
+
+            // Utility methods to refer to the active storage
+            const K* lowers() const;
+            const K* uppers() const;
+            const V* values() const;
+            void grow(unsigned long);
+    };
+
+    /**
+     * Iterator Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    IntervalArray<K, V, C, N>::iterator::iterator(const IntervalArray* array, unsigned long index)
+        : array(array), index(index)
+    { }
+
+    /**
+     * Iterator Infix Operations
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    typename IntervalArray<K, V, C, N>::iterator IntervalArray<K, V, C, N>::iterator::operator++()
+    {
+        index++;
+        return *this;
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    typename IntervalArray<K, V, C, N>::iterator IntervalArray<K, V, C, N>::iterator::operator++(int)
+    {
+        iterator tmp(*this);
+        index++;
+        return tmp;
+    }
+
+    /**
+     * Iterator Reference Operators
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    const V& IntervalArray<K, V, C, N>::iterator::operator*() const
+    {
+        return array->values()[index];
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    const V* IntervalArray<K, V, C, N>::iterator::operator->() const
+    {
+        return &array->values()[index];
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    const std::pair<K, K> IntervalArray<K, V, C, N>::iterator::bounds() const
+    {
+        return std::make_pair(array->lowers()[index], array->uppers()[index]);
+    }
+
+    /**
+     * Iterator Equality Operators
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    const bool IntervalArray<K, V, C, N>::iterator::operator==(const iterator& other)
+    {
+        return array == other.array && index == other.index;
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    const bool IntervalArray<K, V, C, N>::iterator::operator!=(const iterator& other)
+    {
+        return array != other.array || index != other.index;
+    }
+
+    /**
+     * Iterator Methods
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    typename IntervalArray<K, V, C, N>::iterator IntervalArray<K, V, C, N>::begin() const
+    {
+        return iterator(this, 0);
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    typename IntervalArray<K, V, C, N>::iterator IntervalArray<K, V, C, N>::end() const
+    {
+        return iterator(this, count);
+    }
+
+    /**
+     * Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    IntervalArray<K, V, C, N>::IntervalArray()
+        : count(0), capacity(N)
+    { }
+
+    /**
+     * Copy Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    IntervalArray<K, V, C, N>::IntervalArray(const IntervalArray& other)
+        : IntervalArray()
+    {
+        grow(other.count);
+        for(auto it = other.begin(); it != other.end(); it++) {
+            auto bounds = it.bounds();
+            push_back(bounds.first, bounds.second, *it);
+        }
+    }
+
+    /**
+     * Move Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    IntervalArray<K, V, C, N>::IntervalArray(IntervalArray&& other) noexcept
+        : IntervalArray()
+    {
+        swap(*this, other);
+    }
+
+    /**
+     * Assignment Operator
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    IntervalArray<K, V, C, N>& IntervalArray<K, V, C, N>::operator= (IntervalArray other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    /**
+     * Swap Operator
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    void IntervalArray<K, V, C, N>::swap(IntervalArray& a, IntervalArray& b)
+    {
+        using std::swap;
+        swap(a.count, b.count);
+        swap(a.capacity, b.capacity);
+        swap(a.inline_lower, b.inline_lower);
+        swap(a.inline_upper, b.inline_upper);
+        swap(a.inline_value, b.inline_value);
+        swap(a.heap_lower, b.heap_lower);
+        swap(a.heap_upper, b.heap_upper);
+        swap(a.heap_value, b.heap_value);
+    }
+
+    /**
+     * Push Back
+     * ================================
+     *
+     * Appends an interval, which must not precede any interval already in the array.
+     * Runs in amortized O(1) time.
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    void IntervalArray<K, V, C, N>::push_back(K lower_bound, K upper_bound, V value)
+    {
+        if(count == capacity) {
+            grow(2 * capacity);
+        }
+
+        K* lower = heap_lower ? heap_lower.get() : inline_lower;
+        K* upper = heap_upper ? heap_upper.get() : inline_upper;
+        V* data = heap_value ? heap_value.get() : inline_value;
+        lower[count] = lower_bound;
+        upper[count] = upper_bound;
+        data[count] = value;
+        count++;
+    }
+
+    /**
+     * Find
+     * ================================
+     *
+     * Looks for the interval with the largest lower bound not exceeding the passed
+     * interval, and verifies it contains the passed interval. The binary search
+     * is written so that the comparison selects the next base instead of a branch
+     * (compilers emit a conditional move).
+     *
+     * Runs in O(log(n)) time.
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    typename IntervalArray<K, V, C, N>::iterator
+    IntervalArray<K, V, C, N>::find(K lower_bound, K upper_bound, C compare) const
+    {
+        if(count == 0) {
+            return end();
+        }
+
+        const K* base = lowers();
+        unsigned long n = count;
+        while(n > 1) {
+            unsigned long half = n / 2;
+            base = compare(base[half], lower_bound) ? base + half : base;
+            n -= half;
+        }
+
+        unsigned long index = base - lowers();
+        if(compare(*base, lower_bound) && compare(upper_bound, uppers()[index])) {
+            return iterator(this, index);
+        }
+
+        return end();
+    }
+
+    /**
+     * Size
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    unsigned long IntervalArray<K, V, C, N>::size() const
+    {
+        return count;
+    }
+
+    /**
+     * Storage Methods
+     * ================================
+     */
+    template<typename K, typename V, typename C, unsigned int N>
+    const K* IntervalArray<K, V, C, N>::lowers() const
+    {
+        return heap_lower ? heap_lower.get() : inline_lower;
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    const K* IntervalArray<K, V, C, N>::uppers() const
+    {
+        return heap_upper ? heap_upper.get() : inline_upper;
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    const V* IntervalArray<K, V, C, N>::values() const
+    {
+        return heap_value ? heap_value.get() : inline_value;
+    }
+
+    template<typename K, typename V, typename C, unsigned int N>
+    void IntervalArray<K, V, C, N>::grow(unsigned long size)
+    {
+        if(size <= capacity) {
+            return;
+        }
+
+        std::unique_ptr<K[]> lower(new K[size]);
+        std::unique_ptr<K[]> upper(new K[size]);
+        std::unique_ptr<V[]> data(new V[size]);
+        std::copy(lowers(), lowers() + count, lower.get());
+        std::copy(uppers(), uppers() + count, upper.get());
+        std::copy(values(), values() + count, data.get());
+
+        heap_lower.swap(lower);
+        heap_upper.swap(upper);
+        heap_value.swap(data);
+        capacity = size;
+    }
+
     template<typename K, typename V, typename C=std::less_equal<K>>
     class IntervalTree {
 
@@ -58,13 +387,34 @@ namespace sage
             iterator begin() const;
             iterator end() const;
 
+            // An interval (lower bound, upper bound, value) as used by the bulk operations
+            using interval = std::tuple<K, K, V>;
+
             // Constructors
+            // Note copies are deep; the nodes of a tree are never shared with another
             IntervalTree();
+            IntervalTree(const std::vector<interval>&);
+            IntervalTree(const IntervalTree&);
+            IntervalTree(IntervalTree&&) noexcept;
+            IntervalTree& operator= (IntervalTree);
+            void swap(IntervalTree&, IntervalTree&);
 
             // Default Operation
             void insert(K, K, V, C = C());
             iterator find(K, K, C = C()) const;
 
+            // Bulk Operations
+            // Finds every interval overlapping the passed interval, and every interval
+            // containing each of the passed (sorted) points respectively. Stabbing may also
+            // be applied to intervals not yet placed in a tree (if sorted by lower bound).
+            void overlaps(K, K, std::vector<iterator>&, C = C()) const;
+            void stab(const std::vector<K>&, std::vector<std::vector<V>>&, C = C()) const;
+            static void stab(const std::vector<interval>&, const std::vector<K>&,
+                             std::vector<std::vector<V>>&, C = C());
+
+            // Flattens the tree into its frozen form
+            IntervalArray<K, V, C> freeze() const;
+
         private:
 
             struct Node
@@ -95,6 +445,17 @@ namespace sage
             // The root of the tree; always black
             std::shared_ptr<Node> root;
 
+            // Recursively copies the subtree rooted at the passed node
+            static std::shared_ptr<Node> copy(std::shared_ptr<Node>, std::weak_ptr<Node>);
+
+            // Recursively builds a balanced subtree out of the passed range of sorted intervals.
+            // Nodes at the passed depth are colored red (see the bulk constructor).
+            static std::shared_ptr<Node> build(const std::vector<interval>&, unsigned long, unsigned long,
+                                               unsigned long, unsigned long, std::weak_ptr<Node>, C = C());
+
+            // Recursive helper of @overlaps
+            static void overlaps(std::shared_ptr<Node>, K, K, std::vector<iterator>&, C);
+
             // Utility methods to correct the invariants of the tree after the
             // corresponding insertion/removal method respectively
             void insert_fixup(std::shared_ptr<Node>);
@@ -181,18 +542,14 @@ namespace sage
      * Node Constructor
      * ================================
      *
-     * When adding a new node, we must update the parent nodes to ensure
-     * the maximum values are reflected correctly.
+     * Note the parent's maximum cannot be updated here since the node has
+     * not yet been attached as a child. This is done by @insert instead.
      */
     template<typename K, typename V, typename C>
     IntervalTree<K, V, C>::Node::Node(bool red, K lower_bound, K upper_bound, V value, std::weak_ptr<Node> parent)
         : red(red), bounds(std::make_pair(lower_bound, upper_bound))
         , max_upper_bound(upper_bound), value(value), parent(parent)
-    {
-        if(auto p = parent.lock()) {
-            p->updateMaximum();
-        }
-    }
+    { }
 
     /**
      * Node Maximum Update
@@ -255,6 +612,113 @@ namespace sage
         : root(std::shared_ptr<Node>())
     { }
 
+    /**
+     * Copy Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C>
+    IntervalTree<K, V, C>::IntervalTree(const IntervalTree& other)
+        : root(copy(other.root, std::weak_ptr<Node>()))
+    { }
+
+    template<typename K, typename V, typename C>
+    std::shared_ptr<struct IntervalTree<K, V, C>::Node>
+    IntervalTree<K, V, C>::copy(std::shared_ptr<Node> node, std::weak_ptr<Node> parent)
+    {
+        if(!node) {
+            return node;
+        }
+
+        auto result = std::make_shared<Node>(node->red, node->bounds.first, node->bounds.second, node->value, parent);
+        result->max_upper_bound = node->max_upper_bound;
+        result->left = copy(node->left, result);
+        result->right = copy(node->right, result);
+        return result;
+    }
+
+    /**
+     * Bulk Constructor
+     * ================================
+     *
+     * Expects intervals sorted by lower bound. The middle interval becomes the root and
+     * each half is built likewise, such that all levels but the last are full. Coloring
+     * only the nodes of an incomplete last level red thus satisfies every invariant.
+     *
+     * Runs in O(n) time.
+     */
+    template<typename K, typename V, typename C>
+    IntervalTree<K, V, C>::IntervalTree(const std::vector<interval>& intervals)
+    {
+        // Find the depth of the last level, and determine whether it is full
+        unsigned long depth = 0;
+        while((2ul << depth) - 1 < intervals.size()) {
+            depth++;
+        }
+        unsigned long red_depth = ((2ul << depth) - 1 == intervals.size()) ? depth + 1 : depth;
+
+        root = build(intervals, 0, intervals.size(), 0, red_depth, std::weak_ptr<Node>());
+    }
+
+    template<typename K, typename V, typename C>
+    std::shared_ptr<struct IntervalTree<K, V, C>::Node>
+    IntervalTree<K, V, C>::build(const std::vector<interval>& intervals, unsigned long begin, unsigned long end,
+                                 unsigned long depth, unsigned long red_depth, std::weak_ptr<Node> parent, C compare)
+    {
+        if(begin == end) {
+            return std::shared_ptr<Node>();
+        }
+
+        unsigned long middle = begin + (end - begin) / 2;
+        auto& current = intervals[middle];
+        auto result = std::make_shared<Node>(depth == red_depth, std::get<0>(current), std::get<1>(current),
+                                             std::get<2>(current), parent);
+        result->left = build(intervals, begin, middle, depth + 1, red_depth, result, compare);
+        result->right = build(intervals, middle + 1, end, depth + 1, red_depth, result, compare);
+
+        // Children are complete so there is no need to propagate upward
+        if(result->left && compare(result->max_upper_bound, result->left->max_upper_bound)) {
+            result->max_upper_bound = result->left->max_upper_bound;
+        }
+        if(result->right && compare(result->max_upper_bound, result->right->max_upper_bound)) {
+            result->max_upper_bound = result->right->max_upper_bound;
+        }
+
+        return result;
+    }
+
+    /**
+     * Move Constructor
+     * ================================
+     */
+    template<typename K, typename V, typename C>
+    IntervalTree<K, V, C>::IntervalTree(IntervalTree&& other) noexcept
+        : IntervalTree()
+    {
+        swap(*this, other);
+    }
+
+    /**
+     * Assignment Operator
+     * ================================
+     */
+    template<typename K, typename V, typename C>
+    IntervalTree<K, V, C>& IntervalTree<K, V, C>::operator= (IntervalTree other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+
+    /**
+     * Swap Operator
+     * ================================
+     */
+    template<typename K, typename V, typename C>
+    void IntervalTree<K, V, C>::swap(IntervalTree& a, IntervalTree& b)
+    {
+        using std::swap;
+        swap(a.root, b.root);
+    }
+
     /**
      * Iterator Methods
      * ================================
@@ -297,11 +761,13 @@ namespace sage
     void IntervalTree<K, V, C>::insert(K lower_bound, K upper_bound, V value, C compare)
     {
         // Find where to insert element
+        // Note the tree is ordered by lower bound; @compare is inclusive so
+        // we only move left when strictly less than the current lower bound
         auto current = root;
         auto parent = std::weak_ptr<Node>(std::shared_ptr<Node>());
         while(current) {
             parent = current;
-            if(current->left && compare(lower_bound, current->left->max_upper_bound)) {
+            if(!compare(current->bounds.first, lower_bound)) {
                 current = current->left;
             } else {
                 current = current->right;
@@ -312,11 +778,12 @@ namespace sage
         // Otherwise must be at the root
         auto next = std::make_shared<Node>(true, lower_bound, upper_bound, value, parent);
         if(auto ptr = parent.lock()) {
-            if(compare(lower_bound, ptr->max_upper_bound)) {
+            if(!compare(ptr->bounds.first, lower_bound)) {
                 ptr->left = next;
             } else {
                 ptr->right = next;
             }
+            next->updateMaximum();
         } else {
             root = next;
         }
@@ -351,22 +818,26 @@ namespace sage
                 insert_fixup(g_parent);
 
             // Case 2: Uncle is black and parent is left child
+            // If we are the inner child we first rotate so that the parent becomes
+            // the outer child, and the current node becomes the top of the subtree
             } else if(g_parent->left == parent) {
                 if(parent->right == current) {
                     lrRotate(g_parent);
+                    parent = current;
                 }
                 llRotate(g_parent);
                 g_parent->red = true;
-                current->red = false;
+                parent->red = false;
 
             // Case 3: Uncle is black and parent is right child
             } else {
                 if(parent->left == current) {
                     rlRotate(g_parent);
+                    parent = current;
                 }
                 rrRotate(g_parent);
                 g_parent->red = true;
-                current->red = false;
+                parent->red = false;
             }
         }
     }
@@ -399,6 +870,104 @@ namespace sage
         return end();
     }
 
+    /**
+     * Overlaps
+     * ================================
+     *
+     * Collects every interval sharing at least one value with the passed interval, in
+     * sorted order. Subtrees whose maximum upper bound falls short of the passed interval
+     * are skipped, as are right subtrees once lower bounds pass the interval.
+     *
+     * Runs in O(k*log(n)) time, where k is the number of overlapping intervals.
+     */
+    template<typename K, typename V, typename C>
+    void IntervalTree<K, V, C>::overlaps(K lower_bound, K upper_bound, std::vector<iterator>& results, C compare) const
+    {
+        overlaps(root, lower_bound, upper_bound, results, compare);
+    }
+
+    template<typename K, typename V, typename C>
+    void IntervalTree<K, V, C>::overlaps(std::shared_ptr<Node> node, K lower_bound, K upper_bound,
+                                         std::vector<iterator>& results, C compare)
+    {
+        if(!node || !compare(lower_bound, node->max_upper_bound)) {
+            return;
+        }
+
+        overlaps(node->left, lower_bound, upper_bound, results, compare);
+        if(compare(node->bounds.first, upper_bound)) {
+            if(compare(lower_bound, node->bounds.second)) {
+                results.push_back(iterator(node));
+            }
+            overlaps(node->right, lower_bound, upper_bound, results, compare);
+        }
+    }
+
+    /**
+     * Stab
+     * ================================
+     *
+     * For each of the passed points (which must be sorted), gathers the values of all intervals
+     * containing the point. This sweeps the intervals in order alongside the points, maintaining
+     * the intervals that have begun but not yet ended.
+     *
+     * Runs in O(n + q + k) time, where q is the number of points and k is the number of
+     * (interval, point) pairs reported.
+     */
+    template<typename K, typename V, typename C>
+    void IntervalTree<K, V, C>::stab(const std::vector<K>& points, std::vector<std::vector<V>>& results, C compare) const
+    {
+        std::vector<interval> intervals;
+        for(auto it = begin(); it != end(); it++) {
+            intervals.emplace_back(it.bounds().first, it.bounds().second, *it);
+        }
+        stab(intervals, points, results, compare);
+    }
+
+    template<typename K, typename V, typename C>
+    void IntervalTree<K, V, C>::stab(const std::vector<interval>& intervals, const std::vector<K>& points,
+                                     std::vector<std::vector<V>>& results, C compare)
+    {
+        results.assign(points.size(), std::vector<V>());
+
+        auto it = intervals.begin();
+        std::vector<std::pair<K, V>> active;
+        for(unsigned long i = 0; i < points.size(); i++) {
+            for(; it != intervals.end() && compare(std::get<0>(*it), points[i]); it++) {
+                active.emplace_back(std::get<1>(*it), std::get<2>(*it));
+            }
+
+            // Discard any intervals ending before the current point
+            unsigned long kept = 0;
+            for(auto& entry : active) {
+                if(compare(points[i], entry.first)) {
+                    active[kept++] = entry;
+                    results[i].push_back(entry.second);
+                }
+            }
+            active.resize(kept);
+        }
+    }
+
+    /**
+     * Freeze
+     * ================================
+     *
+     * The tree is left untouched; callers no longer needing it should discard it.
+     *
+     * Runs in O(n) time.
+     */
+    template<typename K, typename V, typename C>
+    IntervalArray<K, V, C> IntervalTree<K, V, C>::freeze() const
+    {
+        IntervalArray<K, V, C> result;
+        for(auto it = begin(); it != end(); it++) {
+            auto bounds = it.bounds();
+            result.push_back(bounds.first, bounds.second, *it);
+        }
+        return result;
+    }
+
     /**
      * Rotation Methods
      * ================================
@@ -413,6 +982,9 @@ namespace sage
 
         // Apply rotation
         A->left = B->right;
+        if(A->left) {
+            A->left->parent = A;
+        }
         B->right = A;
 
         // Adjust parents after rotation
@@ -443,6 +1015,9 @@ namespace sage
         // Apply rotation
         A->left = R;
         B->right = R->left;
+        if(B->right) {
+            B->right->parent = B;
+        }
         R->left = B;
 
         // Adjust parents after rotation
@@ -461,6 +1036,9 @@ namespace sage
 
         // Apply rotation
         A->right = B->left;
+        if(A->right) {
+            A->right->parent = A;
+        }
         B->left = A;
 
         // Adjust parents after rotation
@@ -491,6 +1069,9 @@ namespace sage
         // Apply rotation
         A->right = R;
         B->left = R->right;
+        if(B->left) {
+            B->left->parent = B;
+        }
         R->right = B;
 
         // Adjust parents after rotation
@@ -21,15 +21,26 @@
 #define REGEX_SUB_START           '('
 #define REGEX_WILDCARD            '.'
 
-// Pool Keys
-// Used to reference static keys in the Regex pool
-#define REGEX_POOL_CHAR           "char"
-#define REGEX_POOL_FLOAT          "float"
-#define REGEX_POOL_INTEGRAL       "integral"
-#define REGEX_POOL_REPL           "repl"
-#define REGEX_POOL_LETTER         "letter"
-#define REGEX_POOL_WHITESPACE     "whitespace"
-#define REGEX_POOL_WORD           "word"
+// Regex Limits
+// The default maximum number of states an automaton may consist of, which guards against
+// expressions like "a{1,100000}" exhausting memory. It does not bound compile time, which
+// may reach seconds for automata near the limit (see Regex::setStateLimit)
+#define REGEX_STATE_LIMIT         10000
+
+// Regex Cache
+// The default number of bytes of compiled expressions kept by the cache (see RegexCache)
+#define REGEX_CACHE_BUDGET        (16 * 1024 * 1024)
+
+// Scanner Buffering
+// The maximum number of bytes the scanner pulls from its stream at once
+#define SCANNER_CHUNK_SIZE        (64 * 1024)
+
+// The number of chunks read ahead of the scanner when parsing a file (see ReadAhead)
+#define READ_AHEAD_DEPTH          4
+
+// Tree Formatting
+// The number of bytes of formatted output gathered before writing to the stream (see AST::format)
+#define AST_FORMAT_BUFFER         (64 * 1024)
 
 // Preconstructed Expressions
 // By preconstructed I do not mean I generate the Regex for each of these expressions.
@@ -48,6 +59,7 @@
 // These are specific PParser characters used when parsing
 #define PPARSER_CHOOSE            '|'
 #define PPARSER_COMMENT           '#'
+#define PPARSER_DIRECTIVE         '%'
 #define PPARSER_KLEENE_STAR       '*'
 #define PPARSER_KLEENE_PLUS       '+'
 #define PPARSER_KLEENE_OPTIONAL   '?'
@@ -57,4 +69,11 @@
 #define PPARSER_SUB_END           ')'
 #define PPARSER_TERMINAL_DELIM    '"'
 
+// PEG Parser Directives
+// Keywords following a PPARSER_DIRECTIVE character
+#define PPARSER_DIRECTIVE_TOKENS  "tokens"
+#define PPARSER_DIRECTIVE_INLINE  "inline"
+#define PPARSER_DIRECTIVE_TRANSPARENT "transparent"
+#define PPARSER_DIRECTIVE_LEAF    "leaf"
+
 #endif //SAGE_MACRO_H
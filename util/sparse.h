@@ -0,0 +1,158 @@
+/**
+ * sparse.h
+ *
+ * The SparseSet represents a set of integers drawn from [0, n) for some fixed n. Membership
+ * tests, insertions and clearing the set are all constant time operations, while iterating
+ * over the set visits its elements in insertion order.
+ *
+ * This is achieved with two arrays: @dense holds the elements of the set contiguously, while
+ * @sparse maps an element to its position in @dense. An element is a member exactly when the
+ * two arrays agree, so @sparse never needs to be reset (see Briggs and Torczon, 1993).
+ */
+
+#ifndef SAGE_SPARSE_H
+#define SAGE_SPARSE_H
+
+#include <vector>
+
+namespace sage
+{
+    template<typename T = unsigned int>
+    class SparseSet
+    {
+        public:
+
+            // Iterator Methods
+            typename std::vector<T>::const_iterator begin() const;
+            typename std::vector<T>::const_iterator end() const;
+
+            // Constructors
+            SparseSet(T = 0);
+
+            // Default Operations
+            bool insert(T);
+            bool contains(T) const;
+            void clear();
+            void resize(T);
+            T operator[](unsigned long) const;
+            unsigned long size() const;
+            bool empty() const;
+
+        private:
+            std::vector<T> dense;
+            std::vector<T> sparse;
+    };
+
+    /**
+     * Iterator Methods
+     * ================================
+     */
+    template<typename T>
+    typename std::vector<T>::const_iterator SparseSet<T>::begin() const
+    {
+        return dense.begin();
+    }
+
+    template<typename T>
+    typename std::vector<T>::const_iterator SparseSet<T>::end() const
+    {
+        return dense.end();
+    }
+
+    /**
+     * Constructor
+     * ================================
+     */
+    template<typename T>
+    SparseSet<T>::SparseSet(T universe)
+        : sparse(universe)
+    {
+        dense.reserve(universe);
+    }
+
+    /**
+     * Insert
+     * ================================
+     *
+     * Returns true if the element was not already a member of the set.
+     */
+    template<typename T>
+    bool SparseSet<T>::insert(T value)
+    {
+        if(contains(value)) {
+            return false;
+        }
+        sparse[value] = static_cast<T>(dense.size());
+        dense.push_back(value);
+        return true;
+    }
+
+    /**
+     * Contains
+     * ================================
+     */
+    template<typename T>
+    bool SparseSet<T>::contains(T value) const
+    {
+        T index = sparse[value];
+        return index < dense.size() && dense[index] == value;
+    }
+
+    /**
+     * Clear
+     * ================================
+     *
+     * Note @sparse is left as is; stale entries are detected by @contains.
+     */
+    template<typename T>
+    void SparseSet<T>::clear()
+    {
+        dense.clear();
+    }
+
+    /**
+     * Resize
+     * ================================
+     *
+     * Changes the universe of the set, clearing it in the process.
+     */
+    template<typename T>
+    void SparseSet<T>::resize(T universe)
+    {
+        dense.clear();
+        dense.reserve(universe);
+        sparse.assign(universe, 0);
+    }
+
+    /**
+     * Index Operator
+     * ================================
+     *
+     * Returns the element inserted at the given position. Unlike iterators, indices remain
+     * valid while inserting, allowing the set to be used as its own worklist.
+     */
+    template<typename T>
+    T SparseSet<T>::operator[](unsigned long index) const
+    {
+        return dense[index];
+    }
+
+    /**
+     * Size Methods
+     * ================================
+     */
+    template<typename T>
+    unsigned long SparseSet<T>::size() const
+    {
+        return dense.size();
+    }
+
+    template<typename T>
+    bool SparseSet<T>::empty() const
+    {
+        return dense.empty();
+    }
+
+}
+
+#endif //SAGE_SPARSE_H
@@ -0,0 +1,111 @@
+/**
+ * utf8.h
+ *
+ * Helpers for working with UTF-8 encoded text. Regex character classes are matched a byte at a
+ * time, so a range of code points is translated into sequences of byte ranges which together
+ * accept exactly the encodings of the code points in the range.
+ */
+
+#ifndef SAGE_UTF8_H
+#define SAGE_UTF8_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sage
+{
+    // A sequence of byte ranges, each matching a single byte of an encoded code point
+    using utf8_sequence = std::vector<std::pair<unsigned char, unsigned char>>;
+
+    // Number of bytes in the encoding beginning with the given lead byte (0 if not a lead byte)
+    static inline int utf8_length(unsigned char lead)
+    {
+        if(lead < 0x80) {
+            return 1;
+        } else if((lead >> 5) == 0x06) {
+            return 2;
+        } else if((lead >> 4) == 0x0E) {
+            return 3;
+        } else if((lead >> 3) == 0x1E) {
+            return 4;
+        }
+        return 0;
+    }
+
+    // Encode a single code point
+    static inline std::string utf8_encode(unsigned long code)
+    {
+        std::string bytes;
+        if(code < 0x80) {
+            bytes += static_cast<char>(code);
+        } else if(code < 0x800) {
+            bytes += static_cast<char>(0xC0 | (code >> 6));
+            bytes += static_cast<char>(0x80 | (code & 0x3F));
+        } else if(code < 0x10000) {
+            bytes += static_cast<char>(0xE0 | (code >> 12));
+            bytes += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            bytes += static_cast<char>(0xF0 | (code >> 18));
+            bytes += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            bytes += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        return bytes;
+    }
+
+    // Split a range of code points into sequences of byte ranges, such that the encoding of
+    // a code point matches exactly one sequence if and only if it belongs to the range.
+    // Surrogates are excluded as they cannot be encoded.
+    // Ref: https://github.com/BurntSushi/utf8-ranges
+    static inline void utf8_ranges(unsigned long lower, unsigned long upper, std::vector<utf8_sequence>& sequences)
+    {
+        if(lower > upper) {
+            return;
+        }
+
+        // Remove surrogates
+        if(lower <= 0xDFFF && upper >= 0xD800) {
+            utf8_ranges(lower, 0xD7FF, sequences);
+            utf8_ranges(0xE000, upper, sequences);
+            return;
+        }
+
+        // Ranges must be encoded with the same number of bytes
+        for(unsigned long bound : { 0x7FUL, 0x7FFUL, 0xFFFFUL }) {
+            if(lower <= bound && bound < upper) {
+                utf8_ranges(lower, bound, sequences);
+                utf8_ranges(bound + 1, upper, sequences);
+                return;
+            }
+        }
+
+        // Continuation bytes must span their full range unless all preceding bytes are equal
+        for(int i = 1; i < 4; i++) {
+            unsigned long mask = (1UL << (6 * i)) - 1;
+            if((lower & ~mask) != (upper & ~mask)) {
+                if((lower & mask) != 0) {
+                    utf8_ranges(lower, lower | mask, sequences);
+                    utf8_ranges((lower | mask) + 1, upper, sequences);
+                    return;
+                } else if((upper & mask) != mask) {
+                    utf8_ranges(lower, (upper & ~mask) - 1, sequences);
+                    utf8_ranges(upper & ~mask, upper, sequences);
+                    return;
+                }
+            }
+        }
+
+        // Bytes can now be paired up directly
+        utf8_sequence sequence;
+        std::string first = utf8_encode(lower), last = utf8_encode(upper);
+        for(unsigned long i = 0; i < first.size(); i++) {
+            sequence.emplace_back(first[i], last[i]);
+        }
+        sequences.push_back(sequence);
+    }
+
+}
+
+#endif //SAGE_UTF8_H